@@ -0,0 +1,51 @@
+#include "AliasTable.hpp"
+#include <cmath>
+
+AliasTable::AliasTable(const std::vector<double>& weights) {
+    size_t n = weights.size();
+    m_prob.assign(n, 1.0);
+    m_alias.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        m_alias[i] = static_cast<uint32_t>(i);
+    }
+
+    double total = 0;
+    for (double weight : weights) {
+        if (std::isfinite(weight) && weight > 0) total += weight;
+    }
+    if (n == 0 || !(total > 0) || !std::isfinite(total)) return;
+
+    // Scaled so the average column holds exactly 1
+    std::vector<double> scaled(n);
+    std::vector<uint32_t> small;
+    std::vector<uint32_t> large;
+    for (size_t i = 0; i < n; i++) {
+        double weight = weights[i];
+        scaled[i] = std::isfinite(weight) && weight > 0 ? weight * static_cast<double>(n) / total : 0;
+        (scaled[i] < 1.0 ? small : large).push_back(static_cast<uint32_t>(i));
+    }
+
+    while (!small.empty() && !large.empty()) {
+        auto less = small.back();
+        small.pop_back();
+        auto more = large.back();
+
+        m_prob[less] = scaled[less];
+        m_alias[less] = more;
+        scaled[more] -= 1.0 - scaled[less];
+        if (scaled[more] < 1.0) {
+            large.pop_back();
+            small.push_back(more);
+        }
+    }
+    // Whatever is left is 1 give or take rounding, so it always keeps itself
+    for (auto i : small) m_prob[i] = 1.0;
+    for (auto i : large) m_prob[i] = 1.0;
+}
+
+size_t AliasTable::sample(std::mt19937& gen) const {
+    std::uniform_int_distribution<size_t> column(0, m_prob.size() - 1);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    size_t i = column(gen);
+    return coin(gen) < m_prob[i] ? i : m_alias[i];
+}
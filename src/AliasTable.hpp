@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Vose's alias method: picks index i with probability weights[i] / sum in
+// constant time, however many entries there are. Building is linear, so it is
+// done once per folder change rather than per death.
+class AliasTable {
+public:
+    AliasTable() = default;
+    // Negative, NaN and infinite weights count as zero. If nothing is left
+    // with a positive weight every entry is equally likely.
+    explicit AliasTable(const std::vector<double>& weights);
+
+    size_t size() const { return m_prob.size(); }
+    bool empty() const { return m_prob.empty(); }
+
+    // Must not be called on an empty table
+    size_t sample(std::mt19937& gen) const;
+
+private:
+    // Chance of keeping column i rather than taking its alias
+    std::vector<double> m_prob;
+    std::vector<uint32_t> m_alias;
+};
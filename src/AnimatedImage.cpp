@@ -0,0 +1,253 @@
+#include "AnimatedImage.hpp"
+#include "GifDecoder.hpp"
+#include "PngDecoder.hpp"
+#include <cstring>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace {
+    constexpr uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+    uint32_t readU32(const uint8_t* p) {
+        return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | uint32_t(p[3]);
+    }
+    uint16_t readU16(const uint8_t* p) {
+        return static_cast<uint16_t>(p[0] << 8 | p[1]);
+    }
+    void writeU32(std::vector<uint8_t>& out, uint32_t value) {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    // decodePng doesn't check CRCs, so the chunks written here leave them zero
+    void writeChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* body, size_t length) {
+        writeU32(out, static_cast<uint32_t>(length));
+        out.insert(out.end(), type, type + 4);
+        if (length) out.insert(out.end(), body, body + length);
+        writeU32(out, 0);
+    }
+
+    class ApngDecoder : public FrameDecoder {
+    public:
+        static std::unique_ptr<ApngDecoder> open(const uint8_t* data, size_t size) {
+            if (size < 8 || std::memcmp(data, PNG_SIGNATURE, 8) != 0) return nullptr;
+
+            auto decoder = std::make_unique<ApngDecoder>();
+            bool animated = false;
+            bool sawIdat = false;
+            bool idatIsFrame = false;
+            size_t pos = 8;
+            while (size - pos >= 12) {
+                uint32_t length = readU32(data + pos);
+                const uint8_t* type = data + pos + 4;
+                const uint8_t* body = data + pos + 8;
+                if (length > size - pos - 12) return nullptr;
+
+                if (std::memcmp(type, "IHDR", 4) == 0) {
+                    if (length != 13) return nullptr;
+                    decoder->m_header = body;
+                    decoder->m_canvas.width = readU32(body);
+                    decoder->m_canvas.height = readU32(body + 4);
+                } else if (std::memcmp(type, "PLTE", 4) == 0) {
+                    decoder->m_palette = { body, length };
+                } else if (std::memcmp(type, "tRNS", 4) == 0) {
+                    decoder->m_transparency = { body, length };
+                } else if (std::memcmp(type, "acTL", 4) == 0) {
+                    animated = true;
+                } else if (std::memcmp(type, "fcTL", 4) == 0) {
+                    if (length != 26 || !decoder->addFrame(body)) return nullptr;
+                } else if (std::memcmp(type, "IDAT", 4) == 0) {
+                    // Only part of the animation when a frame control came first;
+                    // otherwise it is a still shown by viewers without APNG support
+                    if (!sawIdat) idatIsFrame = !decoder->m_frames.empty();
+                    sawIdat = true;
+                    if (idatIsFrame) {
+                        decoder->m_frames.back().data.emplace_back(body, length);
+                    }
+                } else if (std::memcmp(type, "fdAT", 4) == 0) {
+                    if (length < 4 || decoder->m_frames.empty()) return nullptr;
+                    decoder->m_frames.back().data.emplace_back(body + 4, length - 4);
+                } else if (std::memcmp(type, "IEND", 4) == 0) {
+                    break;
+                }
+                pos += 12 + size_t(length);
+            }
+
+            if (!animated || !decoder->m_header || decoder->m_frames.empty()) return nullptr;
+            if (decoder->m_canvas.width > MAX_CANVAS_SIZE || decoder->m_canvas.height > MAX_CANVAS_SIZE) return nullptr;
+            for (auto& frame : decoder->m_frames) {
+                if (frame.data.empty()) return nullptr;
+            }
+
+            auto& canvas = decoder->m_canvas;
+            canvas.pixels.resize(size_t(canvas.width) * canvas.height * 4);
+            return decoder;
+        }
+
+        size_t frameCount() const override { return m_frames.size(); }
+
+        bool advance() override {
+            size_t next = m_started ? (m_index + 1) % m_frames.size() : 0;
+            if (next == 0) restart();
+            auto& frame = m_frames[next];
+
+            // Dispose-to-previous on the first frame means clearing, per the spec
+            auto dispose = frame.dispose;
+            if (next == 0 && dispose == Dispose::Previous) dispose = Dispose::Background;
+            beginFrame(frame.region, dispose);
+
+            auto image = decodeFrame(frame);
+            if (!image) return false;
+            draw(*image, frame);
+
+            m_started = true;
+            m_index = next;
+            m_delay = frame.delay;
+            return true;
+        }
+
+    private:
+        struct Frame {
+            Region region;
+            float delay = 0;
+            Dispose dispose = Dispose::None;
+            bool blendOver = false;
+            std::vector<std::pair<const uint8_t*, size_t>> data;
+        };
+
+        bool addFrame(const uint8_t* body) {
+            if (!m_header) return false;
+
+            Frame frame;
+            frame.region.width = readU32(body + 4);
+            frame.region.height = readU32(body + 8);
+            frame.region.x = readU32(body + 12);
+            frame.region.y = readU32(body + 16);
+            auto& r = frame.region;
+            if (!r.width || !r.height || r.x > m_canvas.width || r.width > m_canvas.width - r.x
+                || r.y > m_canvas.height || r.height > m_canvas.height - r.y) {
+                return false;
+            }
+
+            unsigned numerator = readU16(body + 20);
+            unsigned denominator = readU16(body + 22);
+            frame.delay = static_cast<float>(numerator) / static_cast<float>(denominator ? denominator : 100);
+            // Browsers treat near-zero delays as 100ms, and so do GIFs below
+            if (frame.delay < 0.011f) frame.delay = 0.1f;
+
+            frame.dispose = body[24] == 1 ? Dispose::Background : body[24] == 2 ? Dispose::Previous : Dispose::None;
+            frame.blendOver = body[25] == 1;
+            m_frames.push_back(std::move(frame));
+            return true;
+        }
+
+        // Wraps the frame's data up as a standalone PNG for decodePng
+        std::optional<DecodedImage> decodeFrame(const Frame& frame) {
+            m_png.assign(PNG_SIGNATURE, PNG_SIGNATURE + 8);
+
+            uint8_t header[13];
+            std::memcpy(header, m_header, 13);
+            for (int i = 0; i < 4; i++) {
+                header[i] = static_cast<uint8_t>(frame.region.width >> (24 - i * 8));
+                header[4 + i] = static_cast<uint8_t>(frame.region.height >> (24 - i * 8));
+            }
+            writeChunk(m_png, "IHDR", header, 13);
+            if (m_palette.first) writeChunk(m_png, "PLTE", m_palette.first, m_palette.second);
+            if (m_transparency.first) writeChunk(m_png, "tRNS", m_transparency.first, m_transparency.second);
+
+            size_t length = 0;
+            for (auto& [data, size] : frame.data) {
+                length += size;
+            }
+            writeU32(m_png, static_cast<uint32_t>(length));
+            m_png.insert(m_png.end(), { 'I', 'D', 'A', 'T' });
+            for (auto& [data, size] : frame.data) {
+                m_png.insert(m_png.end(), data, data + size);
+            }
+            writeU32(m_png, 0);
+            writeChunk(m_png, "IEND", nullptr, 0);
+
+            auto image = decodePng(m_png.data(), m_png.size());
+            if (!image || image->width != frame.region.width || image->height != frame.region.height) {
+                return std::nullopt;
+            }
+            return image;
+        }
+
+        void draw(const DecodedImage& image, const Frame& frame) {
+            auto& r = frame.region;
+            for (uint32_t y = 0; y < r.height; y++) {
+                auto* src = image.pixels.data() + size_t(y) * r.width * 4;
+                auto* dst = m_canvas.pixels.data() + (size_t(r.y + y) * m_canvas.width + r.x) * 4;
+                if (!frame.blendOver) {
+                    std::memcpy(dst, src, size_t(r.width) * 4);
+                    continue;
+                }
+                // Source-over on premultiplied pixels
+                for (uint32_t x = 0; x < r.width; x++, src += 4, dst += 4) {
+                    unsigned alpha = src[3];
+                    if (alpha == 255) {
+                        std::memcpy(dst, src, 4);
+                    } else if (alpha != 0) {
+                        for (int c = 0; c < 4; c++) {
+                            dst[c] = static_cast<uint8_t>(src[c] + (dst[c] * (255 - alpha) + 127) / 255);
+                        }
+                    }
+                }
+            }
+        }
+
+        const uint8_t* m_header = nullptr;
+        std::pair<const uint8_t*, size_t> m_palette {};
+        std::pair<const uint8_t*, size_t> m_transparency {};
+        std::vector<Frame> m_frames;
+        std::vector<uint8_t> m_png;
+        bool m_started = false;
+    };
+}
+
+void FrameDecoder::beginFrame(const Region& region, Dispose dispose) {
+    auto rowBytes = [](const Region& r) { return size_t(r.width) * 4; };
+    auto row = [this](const Region& r, uint32_t y) {
+        return m_canvas.pixels.data() + (size_t(r.y + y) * m_canvas.width + r.x) * 4;
+    };
+
+    auto& last = m_lastRegion;
+    if (m_lastDispose == Dispose::Background) {
+        for (uint32_t y = 0; y < last.height; y++) {
+            std::memset(row(last, y), 0, rowBytes(last));
+        }
+    } else if (m_lastDispose == Dispose::Previous) {
+        for (uint32_t y = 0; y < last.height; y++) {
+            std::memcpy(row(last, y), m_saved.data() + y * rowBytes(last), rowBytes(last));
+        }
+    }
+
+    if (dispose == Dispose::Previous) {
+        m_saved.resize(rowBytes(region) * region.height);
+        for (uint32_t y = 0; y < region.height; y++) {
+            std::memcpy(m_saved.data() + y * rowBytes(region), row(region, y), rowBytes(region));
+        }
+    }
+    m_lastRegion = region;
+    m_lastDispose = dispose;
+}
+
+void FrameDecoder::restart() {
+    std::memset(m_canvas.pixels.data(), 0, m_canvas.pixels.size());
+    m_lastDispose = Dispose::None;
+}
+
+std::unique_ptr<FrameDecoder> openAnimation(const uint8_t* data, size_t size) {
+    if (auto apng = ApngDecoder::open(data, size)) return apng;
+    return openGif(data, size);
+}
+
+std::filesystem::path sheetPathFor(const std::filesystem::path& image) {
+    auto path = image;
+    path.replace_extension(".sheet.json");
+    return path;
+}
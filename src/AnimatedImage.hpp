@@ -0,0 +1,89 @@
+#pragma once
+
+#include "DecodedImage.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Decodes an animated image one frame at a time onto a canvas the size of the
+// whole animation, applying each frame's blend and dispose rules. Only the
+// canvas and the previous frame's area are kept in memory, whatever the clip
+// length. Pixels are premultiplied RGBA like decodePng's. The encoded data
+// must outlive the decoder.
+class FrameDecoder {
+public:
+    // Larger canvases are rejected rather than held in memory for the whole clip
+    static constexpr uint32_t MAX_CANVAS_SIZE = 8192;
+
+    virtual ~FrameDecoder() = default;
+
+    uint32_t width() const { return m_canvas.width; }
+    uint32_t height() const { return m_canvas.height; }
+    virtual size_t frameCount() const = 0;
+    bool animated() const { return frameCount() > 1; }
+
+    // Composes the next frame onto the canvas, starting over after the last.
+    // Returns false if the frame's data is broken.
+    virtual bool advance() = 0;
+
+    // Valid after advance(): the frame just composed and how long it shows for
+    const DecodedImage& canvas() const { return m_canvas; }
+    size_t frameIndex() const { return m_index; }
+    float frameDelay() const { return m_delay; }
+
+protected:
+    enum class Dispose {
+        None,
+        // Clear the frame's area to transparent
+        Background,
+        // Put back what the frame's area held before it was drawn
+        Previous,
+    };
+
+    struct Region {
+        uint32_t x = 0;
+        uint32_t y = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    // Undoes the last frame as its dispose op asks and remembers how to undo
+    // this one, which is about to be drawn into `region` (inside the canvas)
+    void beginFrame(const Region& region, Dispose dispose);
+    // Clears the canvas before the first frame of each loop
+    void restart();
+
+    DecodedImage m_canvas;
+    size_t m_index = 0;
+    float m_delay = 0;
+
+private:
+    Region m_lastRegion;
+    Dispose m_lastDispose = Dispose::None;
+    std::vector<uint8_t> m_saved;
+};
+
+// APNG (any PNG decodePng supports, with an acTL chunk) or GIF. Returns
+// nullptr for anything else, including plain PNGs. A single-frame GIF still
+// opens, since CCImage can't decode GIFs at all.
+std::unique_ptr<FrameDecoder> openAnimation(const uint8_t* data, size_t size);
+
+// Frame grid of a sprite sheet, which plays from a single texture
+struct SheetLayout {
+    uint32_t columns = 1;
+    uint32_t rows = 1;
+    uint32_t frames = 1;
+    float fps = 12;
+};
+
+// What loading found out about an animated image: a sprite sheet, or an
+// APNG/GIF whose frames get streamed from the file
+struct AnimationInfo {
+    std::optional<SheetLayout> sheet;
+};
+
+// `<name>.sheet.json` next to `<name>.png`, which marks it as a sprite sheet
+std::filesystem::path sheetPathFor(const std::filesystem::path& image);
@@ -0,0 +1,302 @@
+#include "AssetScan.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+    uint8_t* slotField(AssetSlot& slot, const std::string& lower) {
+        if (lower == ".png") return &slot.png;
+        if (lower == ".gif") return &slot.gif;
+        if (lower == ".ogg") return &slot.ogg;
+        if (lower == ".mp3") return &slot.mp3;
+        return nullptr;
+    }
+
+    // `lower` with the letters `field` marks as upper-case put back
+    std::string spell(const char* lower, uint8_t field) {
+        std::string ext = lower;
+        for (size_t i = 1; i < ext.size(); i++) {
+            if (field & (1u << i)) ext[i] = static_cast<char>(ext[i] - 'a' + 'A');
+        }
+        return ext;
+    }
+
+    std::vector<std::pair<const std::string*, const AssetSlot*>> sortedImages(const AssetSlots& slots) {
+        std::vector<std::pair<const std::string*, const AssetSlot*>> sorted;
+        sorted.reserve(slots.size());
+        for (const auto& [stem, slot] : slots) {
+            if (slot.hasImage()) sorted.emplace_back(&stem, &slot);
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+            return *a.first < *b.first;
+        });
+        return sorted;
+    }
+}
+
+std::string AssetSlot::imageExtension() const {
+    return png ? spell(".png", png) : spell(".gif", gif);
+}
+
+bool updateAssetSlot(AssetSlots& slots, const std::filesystem::path& file, bool present) {
+    auto ext = file.extension().string();
+    if (ext.size() != 4) return false;
+
+    // Bit 0 marks the file present, bits 1-3 the upper-case letters
+    uint8_t value = 1;
+    for (size_t i = 1; i < ext.size(); i++) {
+        if (ext[i] >= 'A' && ext[i] <= 'Z') {
+            ext[i] = static_cast<char>(ext[i] - 'A' + 'a');
+            value |= static_cast<uint8_t>(1u << i);
+        }
+    }
+    AssetSlot probe;
+    if (!slotField(probe, ext)) return false;
+
+    auto stem = file.stem().string();
+    auto it = slots.find(stem);
+    if (it == slots.end()) {
+        if (!present) return false;
+        it = slots.emplace(std::move(stem), AssetSlot {}).first;
+    }
+
+    *slotField(it->second, ext) = present ? value : 0;
+    if (it->second.empty()) {
+        slots.erase(it);
+    }
+    return true;
+}
+
+void scanAssetFolder(const std::filesystem::path& folder, AssetSlots& slots) {
+    for (const auto& entry : std::filesystem::directory_iterator(folder)) {
+        if (!entry.is_regular_file()) continue;
+        updateAssetSlot(slots, entry.path(), true);
+    }
+}
+
+namespace {
+    struct WalkTask {
+        std::filesystem::path dir;
+        bool root;
+    };
+
+    class TreeWalker {
+    public:
+        TreeWalker(const TreeScanOptions& options, unsigned threads) : m_options(options) {
+            for (unsigned i = 0; i < threads; i++) {
+                m_workers.push_back(std::make_unique<Worker>());
+            }
+        }
+
+        void push(size_t self, WalkTask task) {
+            m_pending++;
+            {
+                std::lock_guard lock(m_workers[self]->mutex);
+                m_workers[self]->queue.push_back(std::move(task));
+            }
+            m_wake.notify_one();
+        }
+
+        void run(size_t self) {
+            auto lastProgress = std::chrono::steady_clock::now();
+            WalkTask task;
+            while (m_pending > 0 && !cancelled()) {
+                if (self == 0 && m_options.onProgress) {
+                    auto now = std::chrono::steady_clock::now();
+                    if (now - lastProgress >= m_options.progressInterval) {
+                        lastProgress = now;
+                        m_options.onProgress(*m_options.progress);
+                    }
+                }
+
+                if (!take(self, task)) {
+                    // Woken by a push, or soon after in case the notify was missed
+                    std::unique_lock lock(m_idleMutex);
+                    m_wake.wait_for(lock, std::chrono::milliseconds(2));
+                    continue;
+                }
+                list(self, task);
+                if (--m_pending == 0) m_wake.notify_all();
+            }
+        }
+
+        TreeScan finish() {
+            TreeScan scan;
+            for (auto& worker : m_workers) {
+                std::move(worker->folders.begin(), worker->folders.end(), std::back_inserter(scan.folders));
+                std::move(worker->directories.begin(), worker->directories.end(), std::back_inserter(scan.directories));
+                std::move(worker->failedRoots.begin(), worker->failedRoots.end(), std::back_inserter(scan.failedRoots));
+            }
+            std::sort(scan.folders.begin(), scan.folders.end(), [](const auto& a, const auto& b) {
+                return a.folder < b.folder;
+            });
+            std::sort(scan.directories.begin(), scan.directories.end());
+            scan.cancelled = cancelled();
+            return scan;
+        }
+
+    private:
+        struct Worker {
+            std::mutex mutex;
+            std::deque<WalkTask> queue;
+            std::vector<ScannedFolder> folders;
+            std::vector<std::filesystem::path> directories;
+            std::vector<std::filesystem::path> failedRoots;
+        };
+
+        bool cancelled() const {
+            return m_options.cancel && m_options.cancel->load(std::memory_order_relaxed);
+        }
+
+        // Newest from our own queue, so a thread stays deep in its part of the
+        // tree; oldest from someone else's, which tends to be a big subtree
+        bool take(size_t self, WalkTask& task) {
+            for (size_t i = 0; i < m_workers.size(); i++) {
+                auto& worker = *m_workers[(self + i) % m_workers.size()];
+                std::lock_guard lock(worker.mutex);
+                if (worker.queue.empty()) continue;
+                if (i == 0) {
+                    task = std::move(worker.queue.back());
+                    worker.queue.pop_back();
+                } else {
+                    task = std::move(worker.queue.front());
+                    worker.queue.pop_front();
+                }
+                return true;
+            }
+            return false;
+        }
+
+        void list(size_t self, const WalkTask& task) {
+            auto& worker = *m_workers[self];
+            std::error_code ec;
+            std::filesystem::directory_iterator it(task.dir, std::filesystem::directory_options::skip_permission_denied, ec);
+            if (ec) {
+                if (task.root) worker.failedRoots.push_back(task.dir);
+                return;
+            }
+            worker.directories.push_back(task.dir);
+
+            AssetSlots slots;
+            uint64_t files = 0;
+            for (; it != std::filesystem::directory_iterator(); it.increment(ec)) {
+                if (ec) break;
+                std::error_code typeEc;
+                auto& entry = *it;
+                if (entry.is_directory(typeEc)) {
+                    if (!m_options.recursive || entry.is_symlink(typeEc)) continue;
+                    if (entry.path().filename().string().starts_with(".")) continue;
+                    push(self, { entry.path(), false });
+                } else if (entry.is_regular_file(typeEc)) {
+                    files++;
+                    updateAssetSlot(slots, entry.path(), true);
+                }
+            }
+
+            if (m_options.progress) {
+                m_options.progress->folders++;
+                m_options.progress->files += files;
+            }
+            if (!slots.empty()) {
+                worker.folders.push_back({ task.dir, std::move(slots) });
+            }
+        }
+
+        const TreeScanOptions& m_options;
+        std::vector<std::unique_ptr<Worker>> m_workers;
+        // Directories queued or being listed
+        std::atomic<size_t> m_pending = 0;
+        std::mutex m_idleMutex;
+        std::condition_variable m_wake;
+    };
+}
+
+TreeScan scanAssetTree(const std::vector<std::filesystem::path>& roots, const TreeScanOptions& options) {
+    // Roots inside other roots would be listed twice, so they are dropped
+    std::vector<std::filesystem::path> unique;
+    for (auto& root : roots) {
+        std::error_code ec;
+        auto path = std::filesystem::weakly_canonical(root, ec);
+        if (ec) path = root.lexically_normal();
+        if (!path.has_filename() && path.has_parent_path()) path = path.parent_path();
+        unique.push_back(std::move(path));
+    }
+    std::sort(unique.begin(), unique.end());
+    unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+    if (options.recursive) {
+        // Sorted, so a root's ancestors come before it
+        std::vector<std::filesystem::path> outer;
+        for (auto& root : unique) {
+            bool nested = std::any_of(outer.begin(), outer.end(), [&](const std::filesystem::path& other) {
+                return std::mismatch(other.begin(), other.end(), root.begin(), root.end()).first == other.end();
+            });
+            if (!nested) outer.push_back(root);
+        }
+        unique = std::move(outer);
+    }
+
+    TreeScanProgress localProgress;
+    TreeScanOptions walkOptions = options;
+    if (!walkOptions.progress) walkOptions.progress = &localProgress;
+
+    unsigned threads = options.threads ? options.threads : std::clamp(std::thread::hardware_concurrency(), 1u, 8u);
+    if (!options.recursive) threads = std::min<unsigned>(threads, static_cast<unsigned>(std::max<size_t>(unique.size(), 1)));
+
+    TreeWalker walker(walkOptions, threads);
+    for (size_t i = 0; i < unique.size(); i++) {
+        walker.push(i % threads, { unique[i], true });
+    }
+
+    std::vector<std::thread> helpers;
+    for (unsigned i = 1; i < threads; i++) {
+        helpers.emplace_back(&TreeWalker::run, &walker, i);
+    }
+    walker.run(0);
+    for (auto& helper : helpers) {
+        helper.join();
+    }
+    return walker.finish();
+}
+
+std::vector<IndexedImage> pairFolderImages(const std::filesystem::path& folder, const AssetSlots& slots) {
+    std::vector<IndexedImage> images;
+    images.reserve(slots.size());
+    for (auto [stem, slot] : sortedImages(slots)) {
+        IndexedImage image;
+        image.imagePath = folder / (*stem + slot->imageExtension());
+        if (slot->ogg) {
+            image.soundPath = folder / (*stem + spell(".ogg", slot->ogg));
+        } else if (slot->mp3) {
+            image.soundPath = folder / (*stem + spell(".mp3", slot->mp3));
+        }
+        images.push_back(std::move(image));
+    }
+    return images;
+}
+
+std::vector<IndexedImage> pairMemes(const std::filesystem::path& folder, const AssetSlots& slots) {
+    std::vector<IndexedImage> memes;
+    for (auto [stem, slot] : sortedImages(slots)) {
+        auto imagePath = folder / (*stem + slot->imageExtension());
+        if (slot->mp3) memes.push_back({ imagePath, folder / (*stem + spell(".mp3", slot->mp3)) });
+        if (slot->ogg) memes.push_back({ imagePath, folder / (*stem + spell(".ogg", slot->ogg)) });
+    }
+    return memes;
+}
+
+std::filesystem::path findMatchingSoundFile(const std::filesystem::path& imagePath) {
+    auto folder = imagePath.parent_path();
+    auto stem = imagePath.stem().string();
+    std::error_code ec;
+
+    for (auto ext : { ".ogg", ".OGG", ".mp3", ".MP3" }) {
+        auto soundPath = folder / (stem + ext);
+        if (std::filesystem::exists(soundPath, ec)) {
+            return soundPath;
+        }
+    }
+    return "";
+}
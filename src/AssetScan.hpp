@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Folder listing and image/sound pairing shared by FolderIndex and
+// MemeManifest. No Geode in here, so the tools can build and benchmark it.
+
+struct IndexedImage {
+    std::filesystem::path imagePath;
+    // Matching .ogg/.mp3 next to the image, empty if there is none
+    std::filesystem::path soundPath;
+};
+
+// Which of the files the mod uses exist for one stem. Extensions match in any
+// case; each field is 0 when the file is missing, otherwise 1 plus a bit per
+// upper-case letter, so paths can be rebuilt the way they are spelled on disk.
+struct AssetSlot {
+    uint8_t png = 0;
+    uint8_t gif = 0;
+    uint8_t ogg = 0;
+    uint8_t mp3 = 0;
+
+    bool empty() const { return !png && !gif && !ogg && !mp3; }
+    bool hasImage() const { return png || gif; }
+    // The PNG wins when a stem has both
+    std::string imageExtension() const;
+};
+
+// Keyed by stem
+using AssetSlots = std::unordered_map<std::string, AssetSlot>;
+
+// Records `file` appearing or disappearing. Returns whether `slots` changed;
+// files the mod doesn't use never change it.
+bool updateAssetSlot(AssetSlots& slots, const std::filesystem::path& file, bool present);
+
+// Lists `folder` (not recursively) into `slots`. Throws
+// std::filesystem::filesystem_error like directory_iterator does.
+void scanAssetFolder(const std::filesystem::path& folder, AssetSlots& slots);
+
+// Everything the mod uses in one directory
+struct ScannedFolder {
+    std::filesystem::path folder;
+    AssetSlots slots;
+};
+
+struct TreeScanProgress {
+    std::atomic<uint64_t> folders = 0;
+    std::atomic<uint64_t> files = 0;
+};
+
+struct TreeScanOptions {
+    bool recursive = true;
+    // Threads listing directories, including the caller's; 0 picks one per
+    // core, up to 8
+    unsigned threads = 0;
+    // Checked between directories
+    const std::atomic<bool>* cancel = nullptr;
+    // Counted as directories are listed; safe to read from any thread
+    TreeScanProgress* progress = nullptr;
+    // Called on the caller's thread about every `progressInterval` while the
+    // scan runs
+    std::function<void(const TreeScanProgress&)> onProgress;
+    std::chrono::milliseconds progressInterval { 1000 };
+};
+
+struct TreeScan {
+    // Sorted by path. Directories holding nothing the mod uses are left out.
+    std::vector<ScannedFolder> folders;
+    // Every directory that was listed, roots included
+    std::vector<std::filesystem::path> directories;
+    // Roots that are missing or can't be listed
+    std::vector<std::filesystem::path> failedRoots;
+    // Set when `cancel` stopped the scan; the rest is then incomplete
+    bool cancelled = false;
+};
+
+// Lists `roots` and, when recursive, every directory below them, in parallel.
+// Each thread works through its own queue of directories and steals from the
+// others once it runs dry. Hidden directories and symlinked directories are
+// skipped, and unreadable subdirectories are left out quietly.
+TreeScan scanAssetTree(const std::vector<std::filesystem::path>& roots, const TreeScanOptions& options = {});
+
+// Folder mode: every image, with its .ogg (or else .mp3) when there is one.
+// Sorted by stem.
+std::vector<IndexedImage> pairFolderImages(const std::filesystem::path& folder, const AssetSlots& slots);
+
+// Meme mode: one entry per image and sound sharing a stem, so a stem with
+// both an .mp3 and an .ogg gives two. Images without a sound are left out.
+// Sorted by stem, .mp3 first.
+std::vector<IndexedImage> pairMemes(const std::filesystem::path& folder, const AssetSlots& slots);
+
+// The .ogg or .mp3 next to `imagePath`, or an empty path if there is neither
+std::filesystem::path findMatchingSoundFile(const std::filesystem::path& imagePath);
@@ -0,0 +1,279 @@
+#include "AsyncLoader.hpp"
+#include "ImageAnimation.hpp"
+#include <Geode/utils/file.hpp>
+#include "Resample.hpp"
+#include "ThumbnailStore.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <chrono>
+
+void LoadHandle::then(std::function<void(CCTexture2D*)> callback) {
+    if (m_state == LoadState::Pending) {
+        m_callbacks.push_back(std::move(callback));
+    } else {
+        callback(m_texture);
+    }
+}
+
+void LoadHandle::finish(CCTexture2D* texture) {
+    m_texture = texture;
+    m_state = texture ? LoadState::Ready : LoadState::Failed;
+
+    auto callbacks = std::move(m_callbacks);
+    for (auto& callback : callbacks) {
+        callback(texture);
+    }
+}
+
+AsyncLoader* AsyncLoader::get() {
+    // Never released: the workers and the scheduler entry live for the whole session
+    static auto* instance = new AsyncLoader();
+    return instance;
+}
+
+AsyncLoader::AsyncLoader() {
+    unsigned count = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 2u);
+    for (unsigned i = 0; i < count; i++) {
+        m_workers.emplace_back(&AsyncLoader::work, this);
+        m_workers.back().detach();
+    }
+    CCDirector::sharedDirector()->getScheduler()->scheduleUpdateForTarget(this, 0, false);
+}
+
+std::shared_ptr<LoadHandle> AsyncLoader::load(const std::filesystem::path& path, const ImageTarget& target) {
+    auto variant = TextureKey { path.string(), 0, 0, target }.variant();
+    if (auto it = m_inFlight.find(variant); it != m_inFlight.end()) {
+        return it->second;
+    }
+
+    auto handle = std::make_shared<LoadHandle>();
+    handle->m_path = path;
+
+    auto& cache = TextureCache::get();
+    if (auto* texture = cache.find(path, target)) {
+        if (auto it = m_animations.find(variant); it != m_animations.end()) {
+            handle->m_animation = it->second;
+        }
+        handle->finish(texture);
+
+        auto job = std::make_unique<Job>();
+        job->path = path;
+        job->target = target;
+        job->cachedKey = cache.keyFor(path, target);
+        submit(std::move(job));
+        return handle;
+    }
+
+    m_inFlight[variant] = handle;
+
+    auto job = std::make_unique<Job>();
+    job->handle = handle;
+    job->path = path;
+    job->target = target;
+    submit(std::move(job));
+    return handle;
+}
+
+void AsyncLoader::submit(std::unique_ptr<Job> job) {
+    {
+        std::lock_guard lock(m_mutex);
+        m_queue.push_back(std::move(job));
+    }
+    m_wake.notify_one();
+}
+
+void AsyncLoader::work() {
+    Trace::setThreadName("loader");
+    while (true) {
+        std::unique_ptr<Job> job;
+        {
+            std::unique_lock lock(m_mutex);
+            m_wake.wait(lock, [this] { return !m_queue.empty(); });
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        try {
+            run(*job);
+        } catch (const std::exception& e) {
+            log::error("Failed to load {}: {}", job->path.string(), e.what());
+            job->image.reset();
+            job->baked = nullptr;
+            job->unchanged = false;
+            job->failed = true;
+        }
+
+        std::lock_guard lock(m_mutex);
+        m_done.push_back(std::move(job));
+    }
+}
+
+void AsyncLoader::run(Job& job) {
+    job.key = TextureCache::makeKey(job.path, job.target);
+    if (job.cachedKey && *job.cachedKey == job.key) {
+        job.unchanged = true;
+        return;
+    }
+    std::error_code ec;
+    if (job.cachedKey && !std::filesystem::is_regular_file(job.path, ec)) {
+        job.unchanged = true;
+        job.missing = true;
+        return;
+    }
+
+    job.fit = job.target;
+    if (auto sheet = readSheetLayout(job.path)) {
+        job.animation = AnimationInfo { sheet };
+        // Each cell gets the whole target, so the sheet may be that many times bigger
+        if (job.fit.width) job.fit.width *= sheet->columns;
+        if (job.fit.height) job.fit.height *= sheet->rows;
+    }
+    if (runBaked(job)) {
+        keepThumbnail(job);
+        return;
+    }
+
+    std::optional<ScopedTrace> trace(std::in_place, TracePhase::Read);
+    auto fileResult = geode::utils::file::readBinary(job.path);
+    if (!fileResult.isOk()) {
+        log::error("Failed to read file data: {}", fileResult.unwrapErr());
+        job.failed = true;
+        return;
+    }
+
+    auto& fileData = fileResult.unwrap();
+    job.contentHash = TextureCache::hashContents(fileData.data(), fileData.size());
+    trace.emplace(TracePhase::Decode);
+
+    if (!job.animation) {
+        if (auto decoder = openAnimation(fileData.data(), fileData.size())) {
+            // Only the first frame is loaded here; playback streams the rest
+            if (decoder->advance()) {
+                if (decoder->animated()) job.animation = AnimationInfo {};
+                job.image = decoder->canvas();
+            }
+        }
+    }
+    if (!job.image) job.image = decodeImage(fileData.data(), fileData.size());
+    if (!job.image) {
+        log::error("Failed to create image from data: {}", job.path.string());
+        job.failed = true;
+        return;
+    }
+    fitToTarget(*job.image, job.fit);
+    keepThumbnail(job);
+}
+
+void AsyncLoader::keepThumbnail(const Job& job) {
+    // A sprite sheet's would show the whole grid
+    if (job.animation && job.animation->sheet) return;
+
+    if (job.image) {
+        ThumbnailStore::get().put(
+            job.path, job.key.mtime, job.key.size, job.image->pixels.data(), job.image->width, job.image->height
+        );
+    } else if (job.baked && job.bakedView.format == BakedFormat::RGBA8888) {
+        ThumbnailStore::get().put(
+            job.path, job.key.mtime, job.key.size, job.bakedView.pixels, job.bakedView.width, job.bakedView.height
+        );
+    }
+}
+
+bool AsyncLoader::runBaked(Job& job) {
+    auto bakedPath = bakedPathFor(job.path);
+    std::error_code ec;
+    auto bakedTime = std::filesystem::last_write_time(bakedPath, ec);
+    if (ec) return false;
+    auto sourceTime = std::filesystem::last_write_time(job.path, ec);
+    // Some slack for archives that only keep timestamps to 2 seconds
+    if (ec || bakedTime + std::chrono::seconds(2) < sourceTime) return false;
+
+    auto file = MappedFile::open(bakedPath);
+    if (!file) return false;
+    auto view = parseBakedImage(file->data(), file->size());
+    if (!view || view->sourceSize != job.key.size) {
+        log::info("Ignoring outdated baked image {}", bakedPath.string());
+        return false;
+    }
+
+    // Baked files of different images never share a texture
+    auto hashed = job.key.path + std::string(reinterpret_cast<const char*>(file->data()), sizeof(BakedImageHeader));
+    job.contentHash = TextureCache::hashContents(reinterpret_cast<const uint8_t*>(hashed.data()), hashed.size());
+
+    auto [width, height] = fittedSize(view->width, view->height, job.fit);
+    if ((width != view->width || height != view->height) && view->format == BakedFormat::RGBA8888) {
+        ScopedTrace trace(TracePhase::Decode);
+        DecodedImage image;
+        image.width = width;
+        image.height = height;
+        image.pixels.resize(static_cast<size_t>(width) * height * 4);
+        resampleArea(view->pixels, view->width, view->height, image.pixels.data(), width, height);
+        job.image = std::move(image);
+        return true;
+    }
+
+    // Fault the pages in here so the upload on the main thread doesn't hit the disk
+    ScopedTrace trace(TracePhase::Read);
+    volatile uint8_t sink = 0;
+    for (size_t offset = 0; offset < view->pixelBytes; offset += 4096) {
+        sink = sink + view->pixels[offset];
+    }
+
+    job.baked = std::move(file);
+    job.bakedView = *view;
+    return true;
+}
+
+void AsyncLoader::update(float) {
+    std::vector<std::unique_ptr<Job>> done;
+    {
+        std::lock_guard lock(m_mutex);
+        if (m_done.empty()) return;
+        done.swap(m_done);
+    }
+
+    auto& cache = TextureCache::get();
+    for (auto& job : done) {
+        if (job->missing) {
+            if (m_missing.insert(job->path.string()).second) {
+                log::warn("{} is gone, keeping the cached image", job->path.string());
+            }
+            continue;
+        }
+        if (!job->failed) m_missing.erase(job->path.string());
+        if (job->unchanged) continue;
+
+        CCTexture2D* texture = nullptr;
+        if (!job->failed) {
+            ScopedTrace trace(TracePhase::Upload);
+            if (auto* existing = cache.findByContents(job->contentHash, job->target)) {
+                texture = cache.insert(job->key, job->contentHash, existing);
+            } else if (auto* uploaded = job->baked
+                ? createTexture(job->bakedView, job->target.mipmaps)
+                : createTexture(*job->image, job->target.mipmaps)
+            ) {
+                log::info("Image dimensions: {} x {}", uploaded->getPixelsWide(), uploaded->getPixelsHigh());
+                texture = cache.insert(job->key, job->contentHash, uploaded);
+                uploaded->release();
+            } else {
+                log::error("Failed to create texture from image");
+            }
+        }
+
+        auto variant = job->key.variant();
+        if (job->animation) {
+            m_animations[variant] = *job->animation;
+        } else {
+            m_animations.erase(variant);
+        }
+
+        if (!job->handle) continue;
+        job->handle->m_animation = job->animation;
+
+        auto it = m_inFlight.find(variant);
+        if (it != m_inFlight.end() && it->second == job->handle) {
+            m_inFlight.erase(it);
+        }
+        job->handle->finish(texture);
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "AnimatedImage.hpp"
+#include "ImageDecoder.hpp"
+#include "MappedFile.hpp"
+#include "TextureCache.hpp"
+#include <Geode/Geode.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace geode::prelude;
+
+enum class LoadState {
+    Pending,
+    Ready,
+    Failed,
+};
+
+// Tracks one image load. Only touched from the main thread; the worker side
+// lives in AsyncLoader::Job.
+class LoadHandle {
+public:
+    LoadState state() const { return m_state; }
+    bool ready() const { return m_state == LoadState::Ready; }
+    // Valid once ready(); owned by the TextureCache
+    CCTexture2D* texture() const { return m_texture; }
+    const std::filesystem::path& path() const { return m_path; }
+    // Set once ready() when the image is a sprite sheet, an APNG or a GIF
+    const std::optional<AnimationInfo>& animation() const { return m_animation; }
+
+    // Runs `callback` on the main thread once the load finishes (with nullptr
+    // if it failed), or right away if it already has.
+    void then(std::function<void(CCTexture2D*)> callback);
+
+private:
+    friend class AsyncLoader;
+
+    void finish(CCTexture2D* texture);
+
+    std::filesystem::path m_path;
+    std::optional<AnimationInfo> m_animation;
+    LoadState m_state = LoadState::Pending;
+    CCTexture2D* m_texture = nullptr;
+    std::vector<std::function<void(CCTexture2D*)>> m_callbacks;
+};
+
+// Reads and decodes images on a small worker pool so the main thread never
+// waits on the disk or the PNG decoder. Finished pixel buffers are uploaded
+// into the TextureCache from update(), which the scheduler calls every frame.
+// A fresh .cdib next to an image (see BakedImage.hpp) is mapped and uploaded
+// as-is instead of decoding the image. Animated images load their first
+// frame (or, for sprite sheets, the whole sheet) and report what they are
+// through LoadHandle::animation(). Every image decoded also leaves a
+// thumbnail in the ThumbnailStore.
+class AsyncLoader : public CCObject {
+public:
+    static AsyncLoader* get();
+
+    // Starts loading `path`, or returns the in-flight handle for it. Images
+    // that are cached already come back ready (and get revalidated against
+    // the file in the background). Images bigger than `target` are shrunk to
+    // it before upload; each target size is cached separately.
+    std::shared_ptr<LoadHandle> load(const std::filesystem::path& path, const ImageTarget& target = {});
+
+    size_t pending() const { return m_inFlight.size(); }
+
+    void update(float dt) override;
+
+private:
+    struct Job {
+        std::shared_ptr<LoadHandle> handle;
+        std::filesystem::path path;
+        ImageTarget target;
+        // Set for revalidation jobs: only decode if the file no longer matches
+        std::optional<TextureKey> cachedKey;
+
+        // Filled in by the worker
+        TextureKey key;
+        uint64_t contentHash = 0;
+        std::optional<AnimationInfo> animation;
+        // `target`, scaled up to the whole grid for sprite sheets
+        ImageTarget fit;
+        std::optional<DecodedImage> image;
+        // Set instead of `image` when the baked file can be uploaded unchanged
+        std::shared_ptr<MappedFile> baked;
+        BakedImageView bakedView;
+        bool unchanged = false;
+        // Revalidation found the file gone; the cached texture is kept
+        bool missing = false;
+        bool failed = false;
+    };
+
+    AsyncLoader();
+    void work();
+    static void run(Job& job);
+    static bool runBaked(Job& job);
+    static void keepThumbnail(const Job& job);
+    void submit(std::unique_ptr<Job> job);
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<std::unique_ptr<Job>> m_queue;
+    std::vector<std::unique_ptr<Job>> m_done;
+    std::vector<std::thread> m_workers;
+
+    // Main thread only, keyed by TextureKey::variant()
+    std::unordered_map<std::string, std::shared_ptr<LoadHandle>> m_inFlight;
+    // Same keys; what the last load of each animated image found
+    std::unordered_map<std::string, AnimationInfo> m_animations;
+    // Cached images whose file has gone, so each is only reported once
+    std::unordered_set<std::string> m_missing;
+};
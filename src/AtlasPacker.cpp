@@ -0,0 +1,72 @@
+#include "AtlasPacker.hpp"
+#include <algorithm>
+#include <limits>
+
+SkylinePacker::SkylinePacker(uint32_t width, uint32_t height) : m_width(width), m_height(height) {
+    m_skyline.push_back({ 0, 0, width });
+}
+
+std::optional<AtlasRect> SkylinePacker::insert(uint32_t width, uint32_t height) {
+    if (width == 0 || height == 0) return std::nullopt;
+
+    size_t best = m_skyline.size();
+    uint32_t bestY = 0;
+    uint32_t bestTop = std::numeric_limits<uint32_t>::max();
+    for (size_t i = 0; i < m_skyline.size(); i++) {
+        auto y = fit(i, width, height);
+        if (y && *y + height < bestTop) {
+            best = i;
+            bestY = *y;
+            bestTop = *y + height;
+        }
+    }
+    if (best == m_skyline.size()) return std::nullopt;
+
+    AtlasRect rect { m_skyline[best].x, bestY, width, height };
+    place(best, rect);
+    m_usedHeight = std::max(m_usedHeight, bestTop);
+    return rect;
+}
+
+// Height a rectangle starting at segment `index` rests at, if it fits there
+std::optional<uint32_t> SkylinePacker::fit(size_t index, uint32_t width, uint32_t height) const {
+    if (m_skyline[index].x + width > m_width) return std::nullopt;
+
+    uint32_t y = 0;
+    uint32_t left = width;
+    // The segments cover the whole page width, so this never runs off the end
+    for (size_t i = index; left > 0; i++) {
+        y = std::max(y, m_skyline[i].y);
+        if (y + height > m_height) return std::nullopt;
+        left -= std::min(left, m_skyline[i].width);
+    }
+    return y;
+}
+
+void SkylinePacker::place(size_t index, const AtlasRect& rect) {
+    m_skyline.insert(m_skyline.begin() + index, Segment { rect.x, rect.y + rect.height, rect.width });
+
+    // Drop or shorten the segments the new one now covers
+    uint32_t end = rect.x + rect.width;
+    size_t i = index + 1;
+    while (i < m_skyline.size() && m_skyline[i].x < end) {
+        auto& segment = m_skyline[i];
+        uint32_t segmentEnd = segment.x + segment.width;
+        if (segmentEnd <= end) {
+            m_skyline.erase(m_skyline.begin() + i);
+            continue;
+        }
+        segment.width = segmentEnd - end;
+        segment.x = end;
+        break;
+    }
+
+    for (size_t j = 0; j + 1 < m_skyline.size();) {
+        if (m_skyline[j].y == m_skyline[j + 1].y) {
+            m_skyline[j].width += m_skyline[j + 1].width;
+            m_skyline.erase(m_skyline.begin() + j + 1);
+        } else {
+            j++;
+        }
+    }
+}
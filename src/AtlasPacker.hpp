@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+struct AtlasRect {
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+// Skyline bottom-left packer for one atlas page. Keeps the top edge of the
+// packed area as a list of horizontal segments and puts each rectangle where
+// its top ends up lowest. Inserting rectangles tallest first packs best.
+class SkylinePacker {
+public:
+    SkylinePacker(uint32_t width, uint32_t height);
+
+    // Where a width x height rectangle went, or nullopt if it doesn't fit
+    std::optional<AtlasRect> insert(uint32_t width, uint32_t height);
+
+    // Lowest height that holds everything packed so far
+    uint32_t usedHeight() const { return m_usedHeight; }
+
+private:
+    struct Segment {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+    };
+
+    std::optional<uint32_t> fit(size_t index, uint32_t width, uint32_t height) const;
+    void place(size_t index, const AtlasRect& rect);
+
+    uint32_t m_width;
+    uint32_t m_height;
+    uint32_t m_usedHeight = 0;
+    std::vector<Segment> m_skyline;
+};
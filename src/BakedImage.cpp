@@ -0,0 +1,75 @@
+#include "BakedImage.hpp"
+#include <cstring>
+
+size_t bytesPerPixel(BakedFormat format) {
+    return format == BakedFormat::RGBA8888 ? 4 : 2;
+}
+
+std::filesystem::path bakedPathFor(const std::filesystem::path& source) {
+    auto path = source;
+    path.replace_extension(".cdib");
+    return path;
+}
+
+std::optional<BakedImageView> parseBakedImage(const uint8_t* data, size_t size) {
+    if (size < sizeof(BakedImageHeader)) return std::nullopt;
+
+    BakedImageHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, BAKED_IMAGE_MAGIC, 4) != 0 || header.version != BAKED_IMAGE_VERSION) {
+        return std::nullopt;
+    }
+    if (header.format != BakedFormat::RGBA8888 && header.format != BakedFormat::RGB565 && header.format != BakedFormat::RGBA4444) {
+        return std::nullopt;
+    }
+    if (!header.width || !header.height || header.pixelOffset < sizeof(header)) return std::nullopt;
+
+    size_t pixelBytes = size_t(header.width) * header.height * bytesPerPixel(header.format);
+    if (header.pixelOffset > size || size - header.pixelOffset < pixelBytes) return std::nullopt;
+
+    BakedImageView view;
+    view.format = header.format;
+    view.width = header.width;
+    view.height = header.height;
+    view.sourceSize = header.sourceSize;
+    view.pixels = data + header.pixelOffset;
+    view.pixelBytes = pixelBytes;
+    return view;
+}
+
+std::vector<uint8_t> bakeImage(const DecodedImage& image, BakedFormat format, uint64_t sourceSize) {
+    BakedImageHeader header = {};
+    std::memcpy(header.magic, BAKED_IMAGE_MAGIC, 4);
+    header.version = BAKED_IMAGE_VERSION;
+    header.format = format;
+    header.width = image.width;
+    header.height = image.height;
+    header.sourceSize = sourceSize;
+    header.pixelOffset = sizeof(header);
+
+    size_t pixels = size_t(image.width) * image.height;
+    std::vector<uint8_t> out(sizeof(header) + pixels * bytesPerPixel(format));
+    std::memcpy(out.data(), &header, sizeof(header));
+
+    auto* dst = out.data() + sizeof(header);
+    auto* src = image.pixels.data();
+    if (format == BakedFormat::RGBA8888) {
+        std::memcpy(dst, src, pixels * 4);
+        return out;
+    }
+
+    for (size_t i = 0; i < pixels; i++) {
+        uint8_t r = src[i * 4 + 0];
+        uint8_t g = src[i * 4 + 1];
+        uint8_t b = src[i * 4 + 2];
+        uint8_t a = src[i * 4 + 3];
+        uint16_t packed;
+        if (format == BakedFormat::RGB565) {
+            packed = static_cast<uint16_t>((r >> 3) << 11 | (g >> 2) << 5 | (b >> 3));
+        } else {
+            packed = static_cast<uint16_t>((r >> 4) << 12 | (g >> 4) << 8 | (b >> 4) << 4 | (a >> 4));
+        }
+        std::memcpy(dst + i * 2, &packed, 2);
+    }
+    return out;
+}
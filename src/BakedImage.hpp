@@ -0,0 +1,56 @@
+#pragma once
+
+#include "DecodedImage.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+// Pixel layouts a .cdib file can hold. All of them upload as-is with
+// CCTexture2D::initWithData; colour channels are premultiplied by alpha.
+enum class BakedFormat : uint16_t {
+    RGBA8888 = 0,
+    RGB565 = 1,
+    RGBA4444 = 2,
+};
+
+// .cdib layout: this header, then `height` rows of tightly packed pixels
+// starting at pixelOffset. Integers are little-endian.
+struct BakedImageHeader {
+    char magic[4];
+    uint16_t version;
+    BakedFormat format;
+    uint32_t width;
+    uint32_t height;
+    // Size of the source image, so a baked file is ignored once its source is replaced
+    uint64_t sourceSize;
+    uint32_t pixelOffset;
+    uint32_t reserved;
+};
+static_assert(sizeof(BakedImageHeader) == 32);
+
+// Points into a mapped .cdib file
+struct BakedImageView {
+    BakedFormat format = BakedFormat::RGBA8888;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint64_t sourceSize = 0;
+    const uint8_t* pixels = nullptr;
+    size_t pixelBytes = 0;
+};
+
+constexpr char BAKED_IMAGE_MAGIC[4] = { 'C', 'D', 'I', 'B' };
+constexpr uint16_t BAKED_IMAGE_VERSION = 1;
+
+size_t bytesPerPixel(BakedFormat format);
+
+// The baked file that goes with `source`: same folder and name, .cdib extension
+std::filesystem::path bakedPathFor(const std::filesystem::path& source);
+
+// Validates the header and size of a .cdib file in memory.
+std::optional<BakedImageView> parseBakedImage(const uint8_t* data, size_t size);
+
+// Encodes premultiplied RGBA pixels as a .cdib file. RGB565 drops alpha, so
+// only use it for opaque images.
+std::vector<uint8_t> bakeImage(const DecodedImage& image, BakedFormat format, uint64_t sourceSize);
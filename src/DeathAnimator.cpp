@@ -0,0 +1,207 @@
+#include "DeathAnimator.hpp"
+#include "Settings.hpp"
+#include <Geode/utils/file.hpp>
+#include <algorithm>
+
+namespace {
+    // Keys are { "at": seconds } or { "before-end": seconds }, plus "value"
+    // and an optional "ease" of "linear", "step", "in" or "out"
+    std::vector<TimelinePreset> parsePresets(const matjson::Value& json) {
+        std::vector<TimelinePreset> presets;
+        for (auto& effect : json) {
+            auto name = effect.getKey();
+            if (!name) continue;
+            TimelinePreset preset;
+            preset.name = *name;
+
+            for (auto& target : effect) {
+                auto targetName = target.getKey().value_or("");
+                TimelineTarget targetId;
+                if (targetName == "image") targetId = TimelineTarget::Image;
+                else if (targetName == "overlay") targetId = TimelineTarget::Overlay;
+                else {
+                    log::warn("Death effect {}: unknown target {}", preset.name, targetName);
+                    continue;
+                }
+
+                for (auto& keys : target) {
+                    auto property = keys.getKey().value_or("");
+                    TimelineTrack track;
+                    track.target = targetId;
+                    if (property == "scale") track.property = TimelineProperty::Scale;
+                    else if (property == "opacity") track.property = TimelineProperty::Opacity;
+                    else if (property == "x") track.property = TimelineProperty::X;
+                    else if (property == "y") track.property = TimelineProperty::Y;
+                    else {
+                        log::warn("Death effect {}: unknown property {}", preset.name, property);
+                        continue;
+                    }
+
+                    for (auto& key : keys) {
+                        TimelineKeyframe keyframe;
+                        if (auto fromEnd = key["before-end"].asDouble()) {
+                            keyframe.time = static_cast<float>(fromEnd.unwrap());
+                            keyframe.fromEnd = true;
+                        } else {
+                            keyframe.time = static_cast<float>(key["at"].asDouble().unwrapOr(0.0));
+                        }
+                        keyframe.value = static_cast<float>(key["value"].asDouble().unwrapOr(0.0));
+
+                        auto ease = key["ease"].asString().unwrapOr("linear");
+                        if (ease == "step") keyframe.ease = TimelineEase::Step;
+                        else if (ease == "in") keyframe.ease = TimelineEase::In;
+                        else if (ease == "out") keyframe.ease = TimelineEase::Out;
+                        track.keys.push_back(keyframe);
+                    }
+                    preset.tracks.push_back(std::move(track));
+                }
+            }
+            presets.push_back(std::move(preset));
+        }
+        return presets;
+    }
+}
+
+DeathEffects& DeathEffects::get() {
+    static DeathEffects instance;
+    return instance;
+}
+
+void DeathEffects::load() {
+    m_loaded = true;
+    auto* mod = Mod::get();
+    for (auto& path : { mod->getSaveDir() / FILE, mod->getResourcesDir() / FILE }) {
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(path, ec)) continue;
+
+        auto text = geode::utils::file::readString(path);
+        if (!text.isOk()) continue;
+        auto parsed = matjson::parse(text.unwrap());
+        if (!parsed.isOk()) {
+            log::error("Invalid death effects: {}", path.string());
+            continue;
+        }
+        m_presets = parsePresets(parsed.unwrap());
+        log::info("Loaded {} death effects from {}", m_presets.size(), path.string());
+        return;
+    }
+    log::error("No death effects found");
+}
+
+void DeathEffects::fit(float duration) {
+    m_duration = duration;
+    m_timelines.clear();
+    for (auto& preset : m_presets) {
+        m_timelines.push_back(std::make_shared<const DeathTimeline>(preset, duration));
+    }
+    m_hold = std::make_shared<const DeathTimeline>(TimelinePreset {}, duration);
+}
+
+std::shared_ptr<const DeathTimeline> DeathEffects::find(std::string_view name) {
+    if (!m_loaded) load();
+    float duration = Settings::get().deathDuration;
+    if (duration != m_duration) fit(duration);
+
+    for (size_t i = 0; i < m_presets.size(); i++) {
+        if (m_presets[i].name == name) return m_timelines[i];
+    }
+    return m_hold;
+}
+
+DeathAnimator* DeathAnimator::get(CCNode* playLayer) {
+    if (auto* animator = playLayer->getChildByID("death-animator")) {
+        return static_cast<DeathAnimator*>(animator);
+    }
+    auto* animator = new DeathAnimator();
+    if (!animator->init()) {
+        delete animator;
+        return nullptr;
+    }
+    animator->autorelease();
+    animator->setID("death-animator");
+    playLayer->addChild(animator);
+    return animator;
+}
+
+bool DeathAnimator::init() {
+    if (!CCNode::init()) return false;
+
+    m_image = CCSprite::create();
+    m_image->setID("death-image");
+    m_image->setAnchorPoint(ccp(0.5f, 0.5f));
+
+    m_overlay = CCLayerColor::create(ccc4(0, 0, 0, 255));
+    m_overlay->setID("black-overlay");
+
+    this->scheduleUpdate();
+    return true;
+}
+
+void DeathAnimator::play(std::shared_ptr<const DeathTimeline> timeline, float fitScale) {
+    auto* layer = this->getParent();
+    if (!layer) return;
+
+    m_timeline = std::move(timeline);
+    m_fitScale = fitScale;
+    m_elapsed = 0;
+
+    if (!m_image->getParent()) layer->addChild(m_image, 1024);
+    bool overlay = m_timeline->animates(TimelineTarget::Overlay);
+    if (overlay && !m_overlay->getParent()) {
+        m_overlay->setContentSize(CCDirector::sharedDirector()->getWinSize());
+        layer->addChild(m_overlay, 1023);
+    } else if (!overlay) {
+        m_overlay->removeFromParent();
+    }
+    apply();
+}
+
+void DeathAnimator::rescale(float factor) {
+    if (m_timeline) m_fitScale *= factor;
+}
+
+void DeathAnimator::detach() {
+    m_timeline = nullptr;
+    // Cleaning up stops the animation; the texture goes so a finished death
+    // doesn't keep its image in memory
+    m_image->removeFromParentAndCleanup(true);
+    m_image->setTexture(nullptr);
+    m_overlay->removeFromParent();
+}
+
+void DeathAnimator::enqueue(std::function<void()> show) {
+    m_queued = std::move(show);
+}
+
+void DeathAnimator::update(float dt) {
+    if (!m_timeline) return;
+    m_elapsed += dt;
+    apply();
+    if (m_elapsed < m_timeline->length()) return;
+
+    detach();
+    if (m_queued) {
+        auto show = std::move(m_queued);
+        m_queued = nullptr;
+        show();
+    }
+}
+
+void DeathAnimator::apply() {
+    auto opacity = [](float value) {
+        return static_cast<GLubyte>(std::clamp(value, 0.0f, 255.0f));
+    };
+
+    TimelineValues values;
+    m_timeline->sample(TimelineTarget::Image, m_elapsed, values);
+    auto winSize = CCDirector::sharedDirector()->getWinSize();
+    m_image->setScale(m_fitScale * values.scale);
+    m_image->setOpacity(opacity(values.opacity));
+    m_image->setPosition(ccp(winSize.width * (0.5f + values.x), winSize.height * (0.5f + values.y)));
+
+    if (m_overlay->getParent()) {
+        TimelineValues overlayValues;
+        m_timeline->sample(TimelineTarget::Overlay, m_elapsed, overlayValues);
+        m_overlay->setOpacity(opacity(overlayValues.opacity));
+    }
+}
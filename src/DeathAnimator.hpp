@@ -0,0 +1,71 @@
+#pragma once
+
+#include "DeathTimeline.hpp"
+#include <Geode/Geode.hpp>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+using namespace geode::prelude;
+
+// The effects in death-effects.json, fitted to the current death duration.
+// A copy of the file in the save dir replaces the one in the resources.
+class DeathEffects {
+public:
+    static constexpr auto FILE = "death-effects.json";
+
+    static DeathEffects& get();
+
+    // The effect called `name`, or one that just holds the image for the
+    // death duration if there isn't one. Main thread only.
+    std::shared_ptr<const DeathTimeline> find(std::string_view name);
+
+private:
+    void load();
+    void fit(float duration);
+
+    bool m_loaded = false;
+    std::vector<TimelinePreset> m_presets;
+    // One per preset, for m_duration
+    std::vector<std::shared_ptr<const DeathTimeline>> m_timelines;
+    std::shared_ptr<const DeathTimeline> m_hold;
+    float m_duration = -1;
+};
+
+// The death image and black overlay of one PlayLayer, and the effect playing
+// on them. The two nodes are made once and re-targeted on every death; they
+// are only on the layer while an effect plays. Effects run from a single
+// scheduled update, instead of a tree of cocos actions built per death.
+class DeathAnimator : public CCNode {
+public:
+    // The layer's animator, added to it the first time
+    static DeathAnimator* get(CCNode* playLayer);
+
+    // The death image, for the caller to put the next image on before play()
+    CCSprite* image() { return m_image; }
+    // Starts `timeline` from the top on the image, and on the overlay if it
+    // animates it. `fitScale` is the image scale that fills the screen.
+    void play(std::shared_ptr<const DeathTimeline> timeline, float fitScale);
+    // For when the image gets a texture of another size halfway through
+    void rescale(float factor);
+    bool playing() const { return m_timeline != nullptr; }
+    // Calls `show` once the current effect ends. Only the latest one waits.
+    void enqueue(std::function<void()> show);
+
+    void update(float dt) override;
+
+protected:
+    bool init() override;
+
+private:
+    void apply();
+    void detach();
+
+    Ref<CCSprite> m_image;
+    Ref<CCLayerColor> m_overlay;
+    std::shared_ptr<const DeathTimeline> m_timeline;
+    std::function<void()> m_queued;
+    float m_fitScale = 1;
+    float m_elapsed = 0;
+};
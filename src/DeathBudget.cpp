@@ -0,0 +1,48 @@
+#include "DeathBudget.hpp"
+#include <Geode/Geode.hpp>
+#include <algorithm>
+#include <vector>
+
+using namespace geode::prelude;
+
+DeathBudget::DeathBudget(float budgetMs)
+    : m_start(std::chrono::steady_clock::now()), m_budgetMs(budgetMs), m_outer(s_current) {
+    s_current = this;
+}
+
+DeathBudget::~DeathBudget() {
+    s_current = m_outer;
+
+    double elapsed = elapsedMs();
+    s_stats.deaths++;
+    s_stats.lastMs = elapsed;
+    s_stats.worstMs = std::max(s_stats.worstMs, elapsed);
+    if (elapsed < m_budgetMs) return;
+
+    s_stats.overBudget++;
+    auto& image = s_slowImages[m_imagePath];
+    image.count++;
+    image.worstMs = std::max(image.worstMs, elapsed);
+    log::warn("Death handler took {:.2f} ms, over its {:.1f} ms budget ({})", elapsed, m_budgetMs, m_imagePath);
+}
+
+double DeathBudget::elapsedMs() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+void DeathBudget::report() {
+    if (!s_stats.deaths) return;
+    log::info(
+        "Death handler: {} deaths, {} over budget, worst {:.2f} ms; {} shown as thumbnails, {} deferred",
+        s_stats.deaths, s_stats.overBudget, s_stats.worstMs, s_stats.previews, s_stats.deferred
+    );
+
+    std::vector<std::pair<std::string, ImageStats>> slowest(s_slowImages.begin(), s_slowImages.end());
+    std::sort(slowest.begin(), slowest.end(), [](const auto& a, const auto& b) {
+        return a.second.count != b.second.count ? a.second.count > b.second.count : a.second.worstMs > b.second.worstMs;
+    });
+    slowest.resize(std::min<size_t>(slowest.size(), 5));
+    for (auto& [path, image] : slowest) {
+        log::info("  {}x over budget, worst {:.2f} ms: {}", image.count, image.worstMs, path.empty() ? "(no image)" : path);
+    }
+}
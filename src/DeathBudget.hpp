@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+
+struct DeathBudgetStats {
+    uint64_t deaths = 0;
+    uint64_t overBudget = 0;
+    // Deaths that showed a thumbnail while the full image loaded
+    uint64_t previews = 0;
+    // Deaths whose image was pushed to the next frame
+    uint64_t deferred = 0;
+    double lastMs = 0;
+    double worstMs = 0;
+};
+
+// Time budget for one run of the death handler (`death-frame-budget`). Work
+// that would start once the budget is spent goes to the next frame instead,
+// and images that aren't loaded yet show their thumbnail until they are.
+// Runs that still end up over budget are counted, along with the image they
+// picked, and reported when the level is left. Main thread only.
+class DeathBudget {
+public:
+    explicit DeathBudget(float budgetMs);
+    ~DeathBudget();
+    DeathBudget(const DeathBudget&) = delete;
+    DeathBudget& operator=(const DeathBudget&) = delete;
+
+    // The handler running right now, or nullptr outside of one
+    static DeathBudget* current() { return s_current; }
+
+    double elapsedMs() const;
+    bool spent() const { return elapsedMs() >= m_budgetMs; }
+    // The image this death picked, so an over-budget run can be traced to it
+    void setImage(const std::filesystem::path& imagePath) { m_imagePath = imagePath.string(); }
+
+    static void notePreview() { s_stats.previews++; }
+    static void noteDeferred() { s_stats.deferred++; }
+    static const DeathBudgetStats& stats() { return s_stats; }
+    // Logs the session's stats and the images most often over budget
+    static void report();
+
+private:
+    struct ImageStats {
+        uint64_t count = 0;
+        double worstMs = 0;
+    };
+
+    std::chrono::steady_clock::time_point m_start;
+    double m_budgetMs;
+    std::string m_imagePath;
+    DeathBudget* m_outer;
+
+    static inline DeathBudget* s_current = nullptr;
+    static inline DeathBudgetStats s_stats;
+    static inline std::unordered_map<std::string, ImageStats> s_slowImages;
+};
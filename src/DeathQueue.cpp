@@ -0,0 +1,110 @@
+#include "DeathQueue.hpp"
+#include "AsyncLoader.hpp"
+#include "ImageAtlas.hpp"
+#include "Settings.hpp"
+#include "SoundBank.hpp"
+#include "ThumbnailCache.hpp"
+#include "Trace.hpp"
+
+DeathQueue& DeathQueue::get() {
+    static DeathQueue instance;
+    return instance;
+}
+
+bool DeathQueue::sync(DeathSource source) {
+    size_t size = 0;
+    bool changed = source != m_source;
+    m_source = source;
+
+    if (source == DeathSource::Folder) {
+        auto folder = FolderIndex::get().snapshot();
+        changed |= folder != m_folder;
+        m_folder = std::move(folder);
+        m_memes = nullptr;
+        size = m_folder ? m_folder->images.size() : 0;
+    } else {
+        auto memes = MemeManifest::get().snapshot();
+        changed |= memes != m_memes;
+        m_memes = std::move(memes);
+        m_folder = nullptr;
+        size = m_memes ? m_memes->size() : 0;
+    }
+
+    if (changed) {
+        m_lookahead.clear();
+        m_bag.reset(size);
+    }
+    // Picks rolled ahead used the old chance, so they are rolled again
+    int rareChance = Settings::get().rareChance;
+    if (rareChance != m_rareChance) {
+        m_rareChance = rareChance;
+        m_lookahead.clear();
+    }
+    if (size == 0) return false;
+
+    fill();
+    return true;
+}
+
+void DeathQueue::fill() {
+    while (m_lookahead.size() < LOOKAHEAD) {
+        m_lookahead.push_back(draw());
+    }
+}
+
+size_t DeathQueue::draw() {
+    if (!m_folder || !m_folder->weighted) return m_bag.next();
+
+    auto& common = m_folder->common;
+    auto& rare = m_folder->rare;
+    bool useRare = common.images.empty();
+    if (!useRare && !rare.images.empty()) {
+        std::uniform_int_distribution<int> roll(0, 99);
+        useRare = roll(m_gen) < Settings::get().rareChance;
+    }
+    auto& tier = useRare ? rare : common;
+    return tier.images[tier.table.sample(m_gen)];
+}
+
+QueuedDeath DeathQueue::resolve(size_t index) const {
+    QueuedDeath death;
+    if (m_folder) {
+        auto& image = m_folder->images[index];
+        death.imagePath = image.imagePath;
+        death.soundPath = image.soundPath;
+    } else {
+        auto meme = m_memes->asset(index);
+        death.imagePath = std::move(meme.imagePath);
+        death.soundPath = std::move(meme.soundPath);
+    }
+    death.frame = ImageAtlas::get()->frame(death.imagePath);
+    return death;
+}
+
+std::optional<QueuedDeath> DeathQueue::pop(DeathSource source) {
+    ScopedTrace trace(TracePhase::Pick);
+    if (!sync(source)) return std::nullopt;
+
+    auto index = m_lookahead.front();
+    m_lookahead.pop_front();
+    fill();
+    return resolve(index);
+}
+
+std::optional<QueuedDeath> DeathQueue::peek(DeathSource source) {
+    if (!sync(source)) return std::nullopt;
+    return resolve(m_lookahead.front());
+}
+
+std::optional<QueuedDeath> DeathQueue::prewarm(DeathSource source) {
+    auto next = peek(source);
+    if (next) {
+        if (!next->frame) {
+            AsyncLoader::get()->load(next->imagePath, screenTarget());
+            // The stand-in shown if the death comes before the load is done
+            ThumbnailCache::get().prewarm(next->imagePath);
+        }
+        SoundBank::get()->preload(next->soundPath);
+    }
+    return next;
+}
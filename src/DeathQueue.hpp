@@ -0,0 +1,59 @@
+#pragma once
+
+#include "FolderIndex.hpp"
+#include "MemeManifest.hpp"
+#include "ShuffleBag.hpp"
+#include <Geode/Geode.hpp>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <random>
+#include <vector>
+
+enum class DeathSource {
+    Folder,
+    Memes,
+};
+
+struct QueuedDeath {
+    std::filesystem::path imagePath;
+    std::filesystem::path soundPath;
+    // Set when the image is packed into the ImageAtlas, so it needs no loading
+    geode::Ref<cocos2d::CCSpriteFrame> frame;
+};
+
+// Decides the next few death images ahead of time so the head of the queue can
+// be loaded while the player is still alive. Folders with a weights file are
+// drawn from by weight, with `rare-chance` deciding between the tiers;
+// everything else cycles through a ShuffleBag.
+class DeathQueue {
+public:
+    static constexpr size_t LOOKAHEAD = 4;
+
+    static DeathQueue& get();
+
+    // Takes the next pick, or nullopt if nothing has been indexed yet.
+    std::optional<QueuedDeath> pop(DeathSource source);
+    // Next pick without taking it.
+    std::optional<QueuedDeath> peek(DeathSource source);
+    // Starts loading the head of the queue so the next death finds it warm.
+    // Returns the head so callers can prepare its sound too.
+    std::optional<QueuedDeath> prewarm(DeathSource source);
+
+private:
+    bool sync(DeathSource source);
+    void fill();
+    size_t draw();
+    QueuedDeath resolve(size_t index) const;
+
+    DeathSource m_source = DeathSource::Folder;
+    std::shared_ptr<const FolderSnapshot> m_folder;
+    std::shared_ptr<const MemeTable> m_memes;
+    ShuffleBag m_bag;
+    std::mt19937 m_gen { std::random_device{}() };
+    std::deque<size_t> m_lookahead;
+    // `rare-chance` the lookahead was rolled with
+    int m_rareChance = -1;
+};
@@ -0,0 +1,68 @@
+#include "DeathTimeline.hpp"
+#include <algorithm>
+
+namespace {
+    float ease(TimelineEase ease, float t) {
+        switch (ease) {
+            case TimelineEase::Step: return 0;
+            case TimelineEase::In: return t * t;
+            case TimelineEase::Out: return 1 - (1 - t) * (1 - t);
+            default: return t;
+        }
+    }
+}
+
+DeathTimeline::DeathTimeline(const TimelinePreset& preset, float duration) {
+    m_length = std::max(duration, 0.0f);
+    for (auto& track : preset.tracks) {
+        if (track.keys.empty()) continue;
+        auto begin = static_cast<uint32_t>(m_keys.size());
+
+        // Keys measured from the end can overtake earlier ones when the
+        // duration is short, so each is held at or after the one before
+        float last = 0;
+        for (auto& key : track.keys) {
+            float time = key.fromEnd ? duration - key.time : key.time;
+            last = std::max(last, time);
+            m_keys.push_back({ last, key.value, key.ease });
+        }
+        m_length = std::max(m_length, last);
+        m_tracks.push_back({ track.target, track.property, begin, static_cast<uint32_t>(m_keys.size()) });
+    }
+}
+
+bool DeathTimeline::animates(TimelineTarget target) const {
+    return std::any_of(m_tracks.begin(), m_tracks.end(), [target](const Track& track) {
+        return track.target == target;
+    });
+}
+
+void DeathTimeline::sample(TimelineTarget target, float time, TimelineValues& values) const {
+    for (auto& track : m_tracks) {
+        if (track.target != target) continue;
+
+        auto first = m_keys.begin() + track.begin;
+        auto last = m_keys.begin() + track.end;
+        // First key after `time`
+        auto next = std::upper_bound(first, last, time, [](float t, const Key& key) { return t < key.time; });
+
+        float value;
+        if (next == first) {
+            value = first->value;
+        } else if (next == last) {
+            value = (last - 1)->value;
+        } else {
+            auto& from = *(next - 1);
+            float span = next->time - from.time;
+            float t = span > 0 ? (time - from.time) / span : 1;
+            value = from.value + (next->value - from.value) * ease(next->ease, t);
+        }
+
+        switch (track.property) {
+            case TimelineProperty::Scale: values.scale = value; break;
+            case TimelineProperty::Opacity: values.opacity = value; break;
+            case TimelineProperty::X: values.x = value; break;
+            case TimelineProperty::Y: values.y = value; break;
+        }
+    }
+}
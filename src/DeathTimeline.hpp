@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class TimelineTarget : uint8_t { Image, Overlay };
+enum class TimelineProperty : uint8_t { Scale, Opacity, X, Y };
+// How a value moves from the previous keyframe to this one
+enum class TimelineEase : uint8_t { Linear, Step, In, Out };
+
+// A keyframe as written in death-effects.json. `time` counts from the start
+// of the death, or back from the end of the death duration with `fromEnd`.
+struct TimelineKeyframe {
+    float time = 0;
+    bool fromEnd = false;
+    float value = 0;
+    TimelineEase ease = TimelineEase::Linear;
+};
+
+struct TimelineTrack {
+    TimelineTarget target = TimelineTarget::Image;
+    TimelineProperty property = TimelineProperty::Opacity;
+    std::vector<TimelineKeyframe> keys;
+};
+
+// A death effect as authored, before it is fitted to a death duration
+struct TimelinePreset {
+    std::string name;
+    std::vector<TimelineTrack> tracks;
+};
+
+// Where a target is at one moment. Scale multiplies the scale that fills the
+// screen, opacity is 0-255 and x/y are offsets from the middle of the screen
+// in screen sizes. Properties without a track keep these values.
+struct TimelineValues {
+    float scale = 1;
+    float opacity = 255;
+    float x = 0;
+    float y = 0;
+};
+
+// A preset fitted to one death duration. Keyframe times are resolved and all
+// tracks share one flat array, so sampling allocates nothing; a new one is
+// only built when the duration setting changes.
+class DeathTimeline {
+public:
+    DeathTimeline() = default;
+    DeathTimeline(const TimelinePreset& preset, float duration);
+
+    // The death duration, or the last keyframe if that comes later
+    float length() const { return m_length; }
+    bool animates(TimelineTarget target) const;
+
+    // Overwrites the properties `target` has tracks for with their values
+    // `time` seconds in
+    void sample(TimelineTarget target, float time, TimelineValues& values) const;
+
+private:
+    struct Key {
+        float time;
+        float value;
+        TimelineEase ease;
+    };
+    struct Track {
+        TimelineTarget target;
+        TimelineProperty property;
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    std::vector<Key> m_keys;
+    std::vector<Track> m_tracks;
+    float m_length = 0;
+};
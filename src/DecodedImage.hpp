@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Decoded pixels in plain memory, safe to hand between threads.
+// Always RGBA8888 with premultiplied alpha, matching what CCImage produces.
+struct DecodedImage {
+    std::vector<uint8_t> pixels;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
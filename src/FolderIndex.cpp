@@ -0,0 +1,329 @@
+#include "FolderIndex.hpp"
+#include "ImageAtlas.hpp"
+#include "Settings.hpp"
+#include "Trace.hpp"
+#include <Geode/Geode.hpp>
+#include <Geode/utils/file.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iterator>
+#include <unordered_map>
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace geode::prelude;
+
+FolderIndex& FolderIndex::get() {
+    static FolderIndex instance;
+    return instance;
+}
+
+void FolderIndex::setRoots(std::vector<std::filesystem::path> roots, bool recursive) {
+    std::erase_if(roots, [](const std::filesystem::path& root) { return root.empty(); });
+    auto state = std::make_shared<WatchState>();
+    state->roots = std::move(roots);
+    state->recursive = recursive;
+
+    {
+        std::lock_guard lock(m_mutex);
+        if (m_watcher) {
+            m_watcher->stopped = true;
+        }
+        m_watcher = state->roots.empty() ? nullptr : state;
+        m_snapshot = nullptr;
+    }
+
+    if (state->roots.empty()) return;
+    std::thread(&FolderIndex::watch, state).detach();
+}
+
+std::shared_ptr<const FolderSnapshot> FolderIndex::snapshot() const {
+    std::lock_guard lock(m_mutex);
+    return m_snapshot;
+}
+
+FolderIndexProgress FolderIndex::progress() const {
+    std::lock_guard lock(m_mutex);
+    FolderIndexProgress progress;
+    if (!m_watcher) return progress;
+    progress.scanning = m_watcher->scanning;
+    progress.folders = m_watcher->progress.folders;
+    progress.files = m_watcher->progress.files;
+    return progress;
+}
+
+bool FolderIndex::scan(WatchState& state) {
+    ScopedTrace trace(TracePhase::Scan);
+    state.scanning = true;
+    state.progress.folders = 0;
+    state.progress.files = 0;
+
+    TreeScanOptions options;
+    options.recursive = state.recursive;
+    options.cancel = &state.stopped;
+    options.progress = &state.progress;
+    options.onProgress = [](const TreeScanProgress& progress) {
+        log::info("Indexing images: {} files in {} folders so far", progress.files.load(), progress.folders.load());
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    auto tree = scanAssetTree(state.roots, options);
+    state.scanning = false;
+    if (tree.cancelled) return false;
+
+    for (auto& root : tree.failedRoots) {
+        log::error("Could not read folder: {}", root.string());
+    }
+    state.folders.clear();
+    for (auto& dir : tree.directories) {
+        state.folders[dir];
+    }
+    for (auto& folder : tree.folders) {
+        state.folders[folder.folder] = std::move(folder.slots);
+    }
+    readWeights(state);
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    log::info("Scanned {} files in {} folders in {} ms", state.progress.files.load(), tree.directories.size(), ms);
+    return !tree.directories.empty();
+}
+
+bool FolderIndex::applyChange(WatchState& state, const std::filesystem::path& file) {
+    if (file.filename() == WEIGHTS_FILE) {
+        readWeights(state);
+        return true;
+    }
+    auto it = state.folders.find(file.parent_path());
+    if (it == state.folders.end()) return false;
+    std::error_code ec;
+    return updateAssetSlot(it->second, file, std::filesystem::is_regular_file(file, ec));
+}
+
+void FolderIndex::readWeights(WatchState& state) {
+    state.hasWeights = false;
+    state.defaultWeight = 1.0;
+    state.weights.clear();
+
+    // Later roots win where two name the same image
+    for (auto& root : state.roots) {
+        auto path = root / WEIGHTS_FILE;
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(path, ec)) continue;
+
+        auto text = geode::utils::file::readString(path);
+        if (!text.isOk()) continue;
+        auto parsed = matjson::parse(text.unwrap());
+        if (!parsed.isOk()) {
+            log::error("Invalid image weights: {}", path.string());
+            continue;
+        }
+
+        auto json = parsed.unwrap();
+        if (!state.hasWeights) {
+            state.defaultWeight = std::max(0.0, json["default-weight"].asDouble().unwrapOr(1.0));
+        }
+        state.hasWeights = true;
+        for (auto& entry : json["images"]) {
+            auto name = entry.getKey();
+            if (!name) continue;
+
+            ImageWeight weight { state.defaultWeight, false };
+            if (entry.isNumber()) {
+                weight.weight = entry.asDouble().unwrapOr(state.defaultWeight);
+            } else {
+                weight.weight = entry["weight"].asDouble().unwrapOr(state.defaultWeight);
+                weight.rare = entry["tier"].asString().unwrapOr("") == "rare";
+            }
+            if (!std::isfinite(weight.weight) || weight.weight < 0) weight.weight = 0;
+            state.weights[*name] = weight;
+        }
+    }
+}
+
+void FolderIndex::buildTiers(const WatchState& state, FolderSnapshot& snapshot) {
+    snapshot.weighted = state.hasWeights;
+    if (!state.hasWeights) return;
+
+    std::vector<double> commonWeights;
+    std::vector<double> rareWeights;
+    for (size_t i = 0; i < snapshot.images.size(); i++) {
+        auto& path = snapshot.images[i].imagePath;
+        ImageWeight weight { state.defaultWeight, false };
+        auto it = state.weights.find(path.stem().string());
+        if (it == state.weights.end()) it = state.weights.find(path.filename().string());
+        if (it != state.weights.end()) weight = it->second;
+
+        auto& tier = weight.rare ? snapshot.rare : snapshot.common;
+        tier.images.push_back(static_cast<uint32_t>(i));
+        (weight.rare ? rareWeights : commonWeights).push_back(weight.weight);
+    }
+    snapshot.common.table = AliasTable(commonWeights);
+    snapshot.rare.table = AliasTable(rareWeights);
+}
+
+void FolderIndex::publish(const std::shared_ptr<WatchState>& state) {
+    auto snapshot = std::make_shared<FolderSnapshot>();
+    snapshot->roots = state->roots;
+    for (auto& [folder, slots] : state->folders) {
+        if (slots.empty()) continue;
+        auto images = pairFolderImages(folder, slots);
+        std::move(images.begin(), images.end(), std::back_inserter(snapshot->images));
+    }
+    buildTiers(*state, *snapshot);
+
+    {
+        std::lock_guard lock(m_mutex);
+        if (m_watcher != state) return;
+        snapshot->generation = ++m_generation;
+        m_snapshot = std::move(snapshot);
+    }
+    Loader::get()->queueInMainThread([] { ImageAtlas::get()->refresh(); });
+}
+
+void FolderIndex::watch(std::shared_ptr<WatchState> state) {
+    Trace::setThreadName("folder-index");
+    auto& index = FolderIndex::get();
+    bool useInotify = true;
+
+    while (!state->stopped) {
+        scan(*state);
+        if (state->stopped) return;
+        index.publish(state);
+        if (auto snapshot = index.snapshot()) {
+            log::info("Indexed {} images in {} folders", snapshot->images.size(), state->folders.size());
+            if (snapshot->weighted) {
+                log::info("Weighted selection: {} common, {} rare", snapshot->common.images.size(), snapshot->rare.images.size());
+            }
+        }
+
+#ifdef __linux__
+        if (useInotify) {
+            auto end = index.watchInotify(state);
+            if (end == WatchEnd::Rescan) continue;
+            if (end == WatchEnd::Stopped) return;
+            // A root went away, or there are more folders than inotify watches
+            useInotify = false;
+        }
+#endif
+        pollChanges(*state);
+    }
+}
+
+#ifdef __linux__
+FolderIndex::WatchEnd FolderIndex::watchInotify(const std::shared_ptr<WatchState>& state) {
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return WatchEnd::Poll;
+
+    std::unordered_map<int, std::filesystem::path> watches;
+    for (auto& [folder, slots] : state->folders) {
+        int wd = inotify_add_watch(
+            fd, folder.string().c_str(),
+            IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF
+        );
+        if (wd < 0) {
+            close(fd);
+            return WatchEnd::Poll;
+        }
+        watches[wd] = folder;
+    }
+    if (watches.empty()) {
+        close(fd);
+        return WatchEnd::Poll;
+    }
+
+    alignas(inotify_event) char buffer[16 * 1024];
+    pollfd pfd { fd, POLLIN, 0 };
+    auto end = WatchEnd::Stopped;
+
+    while (!state->stopped && end == WatchEnd::Stopped) {
+        if (poll(&pfd, 1, 500) <= 0) continue;
+
+        bool changed = false;
+        bool rescan = false;
+        bool rootGone = false;
+        ssize_t length;
+        while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+            for (char* ptr = buffer; ptr < buffer + length;) {
+                auto* event = reinterpret_cast<inotify_event*>(ptr);
+                ptr += sizeof(inotify_event) + event->len;
+
+                auto watch = watches.find(event->wd);
+                if (event->mask & IN_Q_OVERFLOW) {
+                    rescan = true;
+                } else if (watch == watches.end()) {
+                    continue;
+                } else if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                    // Roots are the folders whose parent isn't indexed
+                    rootGone |= !state->folders.contains(watch->second.parent_path());
+                    rescan = true;
+                } else if (event->mask & IN_ISDIR) {
+                    // New and removed subfolders change what there is to watch
+                    rescan |= state->recursive && event->len > 0;
+                } else if (event->len > 0) {
+                    changed |= applyChange(*state, watch->second / event->name);
+                }
+            }
+        }
+
+        if (rootGone) {
+            end = WatchEnd::Poll;
+        } else if (rescan) {
+            end = WatchEnd::Rescan;
+        } else if (changed && !state->stopped) {
+            publish(state);
+        }
+    }
+    close(fd);
+    return state->stopped ? WatchEnd::Stopped : end;
+}
+#endif
+
+void FolderIndex::pollChanges(WatchState& state) {
+    // Adding, removing or renaming files bumps the directory's mtime, so that
+    // is all we need to look at between full rescans, besides edits to the
+    // weights files. Roots are included so a missing one is noticed appearing.
+    std::vector<std::filesystem::path> watched = state.roots;
+    for (auto& root : state.roots) {
+        watched.push_back(root / WEIGHTS_FILE);
+    }
+    for (auto& [folder, slots] : state.folders) {
+        watched.push_back(folder);
+    }
+
+    auto stamps = [&] {
+        std::vector<std::filesystem::file_time_type> times;
+        times.reserve(watched.size());
+        for (auto& path : watched) {
+            std::error_code ec;
+            times.push_back(std::filesystem::last_write_time(path, ec));
+        }
+        return times;
+    };
+
+    auto last = stamps();
+    while (!state.stopped) {
+        std::this_thread::sleep_for(std::chrono::seconds(2));
+        if (state.stopped || stamps() != last) return;
+    }
+}
+
+$on_mod(Loaded) {
+    Settings::listen([](const Settings& settings, const Settings* previous) {
+        if (previous && settings.useFolder == previous->useFolder && settings.folderRoots == previous->folderRoots
+            && settings.scanSubfolders == previous->scanSubfolders) {
+            return;
+        }
+        // Nothing reads the folders outside folder mode
+        if (!settings.useFolder) {
+            FolderIndex::get().setRoots({}, false);
+            return;
+        }
+        FolderIndex::get().setRoots(settings.folderRoots, settings.scanSubfolders);
+    });
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "AliasTable.hpp"
+#include "AssetScan.hpp"
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Images that share a rarity, with an alias table over their weights
+struct ImageTier {
+    // Indices into FolderSnapshot::images
+    std::vector<uint32_t> images;
+    AliasTable table;
+};
+
+// Immutable view of the folders at one point in time. Deaths pick from
+// `images` directly, so a pick is a single array read.
+struct FolderSnapshot {
+    std::vector<std::filesystem::path> roots;
+    // Sorted by directory, then by stem
+    std::vector<IndexedImage> images;
+    uint64_t generation = 0;
+
+    // Set when a root has a weights.json. Every image is then in exactly
+    // one tier, and deaths draw from the tiers instead of shuffling `images`.
+    bool weighted = false;
+    ImageTier common;
+    ImageTier rare;
+};
+
+struct FolderIndexProgress {
+    bool scanning = false;
+    uint64_t folders = 0;
+    uint64_t files = 0;
+};
+
+// While `use-folder` is on, keeps an in-memory index of `custom-folder-path`
+// and `extra-folder-paths` so deaths never touch the disk to find an image.
+// The roots (and, with `scan-subfolders`, everything below them) are scanned
+// in parallel on a background thread and then kept up to date (inotify on
+// Linux/Android, directory mtime polling everywhere else).
+class FolderIndex {
+public:
+    // Optional per-image weights and rarity tiers, read from each root, e.g.
+    //   { "default-weight": 1, "images": { "cat": 3, "gold": { "weight": 1, "tier": "rare" } } }
+    // Images are named by stem or by file name.
+    static constexpr const char* WEIGHTS_FILE = "weights.json";
+
+    static FolderIndex& get();
+
+    // Starts indexing `roots`, dropping whatever was indexed before. Empty
+    // paths are ignored.
+    void setRoots(std::vector<std::filesystem::path> roots, bool recursive);
+
+    // Latest published snapshot, or nullptr while the first scan is running
+    // (or there are no roots).
+    std::shared_ptr<const FolderSnapshot> snapshot() const;
+    // How far the running scan has got
+    FolderIndexProgress progress() const;
+
+private:
+    struct ImageWeight {
+        double weight = 1.0;
+        bool rare = false;
+    };
+
+    struct WatchState {
+        std::vector<std::filesystem::path> roots;
+        bool recursive = false;
+        std::atomic<bool> stopped = false;
+        std::atomic<bool> scanning = false;
+        TreeScanProgress progress;
+        // Every directory listed, including those without images
+        std::map<std::filesystem::path, AssetSlots> folders;
+        // From each root's WEIGHTS_FILE, keyed by the name the file gives
+        bool hasWeights = false;
+        double defaultWeight = 1.0;
+        std::unordered_map<std::string, ImageWeight> weights;
+    };
+
+    enum class WatchEnd {
+        Rescan,
+        Poll,
+        Stopped,
+    };
+
+    static void watch(std::shared_ptr<WatchState> state);
+    // Applies changes as they come in; returns once a full rescan is needed,
+    // inotify can't cover the folders, or the watcher is stopped
+    WatchEnd watchInotify(const std::shared_ptr<WatchState>& state);
+    // Returns once anything looks different, or the watcher is stopped
+    static void pollChanges(WatchState& state);
+    static bool scan(WatchState& state);
+    static bool applyChange(WatchState& state, const std::filesystem::path& file);
+    static void readWeights(WatchState& state);
+    static void buildTiers(const WatchState& state, FolderSnapshot& snapshot);
+    void publish(const std::shared_ptr<WatchState>& state);
+
+    mutable std::mutex m_mutex;
+    std::shared_ptr<WatchState> m_watcher;
+    std::shared_ptr<const FolderSnapshot> m_snapshot;
+    uint64_t m_generation = 0;
+};
@@ -0,0 +1,88 @@
+#include "FrameStream.hpp"
+#include "AnimatedImage.hpp"
+#include "MappedFile.hpp"
+#include "Resample.hpp"
+#include <algorithm>
+#include <thread>
+
+FrameStream::FrameStream(const std::filesystem::path& path, uint32_t width, uint32_t height)
+    : m_shared(std::make_shared<Shared>()) {
+    // Detached so dropping the stream never waits on a frame mid-decode
+    std::thread(&FrameStream::run, m_shared, path, width, height).detach();
+}
+
+FrameStream::~FrameStream() {
+    {
+        std::lock_guard lock(m_shared->mutex);
+        m_shared->stopped = true;
+    }
+    m_shared->wake.notify_all();
+}
+
+std::optional<StreamedFrame> FrameStream::pop() {
+    std::optional<StreamedFrame> frame;
+    {
+        std::lock_guard lock(m_shared->mutex);
+        if (m_shared->ready.empty()) return std::nullopt;
+        frame = std::move(m_shared->ready.front());
+        m_shared->ready.pop_front();
+    }
+    m_shared->wake.notify_all();
+    return frame;
+}
+
+void FrameStream::recycle(DecodedImage&& image) {
+    std::lock_guard lock(m_shared->mutex);
+    if (m_shared->spare.size() < RING_SIZE) {
+        m_shared->spare.push_back(std::move(image.pixels));
+    }
+}
+
+bool FrameStream::failed() const {
+    std::lock_guard lock(m_shared->mutex);
+    return m_shared->failed;
+}
+
+void FrameStream::run(std::shared_ptr<Shared> shared, std::filesystem::path path, uint32_t width, uint32_t height) {
+    auto fail = [&] {
+        std::lock_guard lock(shared->mutex);
+        shared->failed = true;
+    };
+
+    auto file = MappedFile::open(path);
+    auto decoder = file ? openAnimation(file->data(), file->size()) : nullptr;
+    if (!decoder) return fail();
+
+    width = std::min(width, decoder->width());
+    height = std::min(height, decoder->height());
+    bool shrink = width < decoder->width() || height < decoder->height();
+
+    while (true) {
+        StreamedFrame frame;
+        {
+            std::unique_lock lock(shared->mutex);
+            shared->wake.wait(lock, [&] { return shared->stopped || shared->ready.size() < RING_SIZE; });
+            if (shared->stopped) return;
+            if (!shared->spare.empty()) {
+                frame.image.pixels = std::move(shared->spare.back());
+                shared->spare.pop_back();
+            }
+        }
+
+        if (!decoder->advance()) return fail();
+        auto& canvas = decoder->canvas();
+        frame.index = decoder->frameIndex();
+        frame.delay = decoder->frameDelay();
+        frame.image.width = width;
+        frame.image.height = height;
+        if (shrink) {
+            frame.image.pixels.resize(size_t(width) * height * 4);
+            resampleArea(canvas.pixels.data(), canvas.width, canvas.height, frame.image.pixels.data(), width, height);
+        } else {
+            frame.image.pixels.assign(canvas.pixels.begin(), canvas.pixels.end());
+        }
+
+        std::lock_guard lock(shared->mutex);
+        shared->ready.push_back(std::move(frame));
+    }
+}
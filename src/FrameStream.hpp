@@ -0,0 +1,54 @@
+#pragma once
+
+#include "DecodedImage.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+struct StreamedFrame {
+    DecodedImage image;
+    size_t index = 0;
+    // How long the frame stays up, in seconds
+    float delay = 0;
+};
+
+// Decodes an animation on its own thread, looping, and stays at most
+// RING_SIZE frames ahead of whoever pops them. Memory is bounded by the ring
+// plus the decoder's canvas, however long the clip is. Frames are shrunk to
+// width x height when the canvas is bigger.
+class FrameStream {
+public:
+    static constexpr size_t RING_SIZE = 3;
+
+    FrameStream(const std::filesystem::path& path, uint32_t width, uint32_t height);
+    ~FrameStream();
+    FrameStream(const FrameStream&) = delete;
+    FrameStream& operator=(const FrameStream&) = delete;
+
+    // The next frame if it has been decoded, without waiting for it
+    std::optional<StreamedFrame> pop();
+    // Hands a popped frame's buffer back so the decoder can reuse it
+    void recycle(DecodedImage&& image);
+    // True once the file turned out unreadable or a frame failed to decode
+    bool failed() const;
+
+private:
+    struct Shared {
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::deque<StreamedFrame> ready;
+        std::vector<std::vector<uint8_t>> spare;
+        bool stopped = false;
+        bool failed = false;
+    };
+
+    static void run(std::shared_ptr<Shared> shared, std::filesystem::path path, uint32_t width, uint32_t height);
+
+    std::shared_ptr<Shared> m_shared;
+};
@@ -0,0 +1,278 @@
+#include "GifDecoder.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+    uint16_t readU16(const uint8_t* p) {
+        return static_cast<uint16_t>(p[0] | p[1] << 8);
+    }
+
+    class GifDecoder : public FrameDecoder {
+    public:
+        static std::unique_ptr<GifDecoder> open(const uint8_t* data, size_t size) {
+            if (size < 13 || (std::memcmp(data, "GIF87a", 6) != 0 && std::memcmp(data, "GIF89a", 6) != 0)) {
+                return nullptr;
+            }
+
+            auto decoder = std::make_unique<GifDecoder>();
+            auto& canvas = decoder->m_canvas;
+            canvas.width = readU16(data + 6);
+            canvas.height = readU16(data + 8);
+            if (!canvas.width || !canvas.height || canvas.width > MAX_CANVAS_SIZE || canvas.height > MAX_CANVAS_SIZE) {
+                return nullptr;
+            }
+
+            size_t pos = 13;
+            uint8_t flags = data[10];
+            if (flags & 0x80) {
+                size_t entries = size_t(2) << (flags & 7);
+                if (size - pos < entries * 3) return nullptr;
+                decoder->m_globalPalette = { data + pos, entries };
+                pos += entries * 3;
+            }
+
+            // Index the frames; a truncated file keeps the ones before the damage
+            Control control;
+            while (pos < size) {
+                uint8_t introducer = data[pos++];
+                if (introducer == 0x3b) break;
+
+                if (introducer == 0x21) {
+                    if (pos >= size) break;
+                    uint8_t label = data[pos++];
+                    if (label == 0xf9 && pos + 5 < size && data[pos] == 4) {
+                        uint8_t packed = data[pos + 1];
+                        unsigned method = (packed >> 2) & 7;
+                        control.dispose = method == 2 ? Dispose::Background : method == 3 ? Dispose::Previous : Dispose::None;
+                        unsigned delay = readU16(data + pos + 2);
+                        // Same floor browsers use for "as fast as possible" GIFs
+                        control.delay = delay < 2 ? 0.1f : delay / 100.0f;
+                        control.transparent = (packed & 1) ? data[pos + 4] : -1;
+                    }
+                    if (!skipSubBlocks(data, size, pos)) break;
+                    continue;
+                }
+
+                if (introducer != 0x2c || size - pos < 9) break;
+                Frame frame;
+                frame.control = control;
+                control = Control {};
+                frame.region.x = readU16(data + pos);
+                frame.region.y = readU16(data + pos + 2);
+                frame.region.width = readU16(data + pos + 4);
+                frame.region.height = readU16(data + pos + 6);
+                uint8_t imageFlags = data[pos + 8];
+                frame.interlaced = imageFlags & 0x40;
+                pos += 9;
+
+                frame.palette = decoder->m_globalPalette;
+                if (imageFlags & 0x80) {
+                    size_t entries = size_t(2) << (imageFlags & 7);
+                    if (size - pos < entries * 3) break;
+                    frame.palette = { data + pos, entries };
+                    pos += entries * 3;
+                }
+
+                if (pos >= size) break;
+                frame.minCodeSize = data[pos++];
+                frame.data = pos;
+                if (!skipSubBlocks(data, size, pos)) break;
+                frame.dataEnd = pos;
+
+                if (frame.minCodeSize < 2 || frame.minCodeSize > 11 || !frame.palette.first) continue;
+                if (!decoder->clip(frame)) continue;
+                decoder->m_frames.push_back(frame);
+            }
+            if (decoder->m_frames.empty()) return nullptr;
+
+            decoder->m_data = data;
+            canvas.pixels.resize(size_t(canvas.width) * canvas.height * 4);
+            return decoder;
+        }
+
+        size_t frameCount() const override { return m_frames.size(); }
+
+        bool advance() override {
+            size_t next = m_started ? (m_index + 1) % m_frames.size() : 0;
+            if (next == 0) restart();
+            auto& frame = m_frames[next];
+
+            beginFrame(frame.visible, frame.control.dispose);
+            if (!decodeIndices(frame)) return false;
+            draw(frame);
+
+            m_started = true;
+            m_index = next;
+            m_delay = frame.control.delay;
+            return true;
+        }
+
+    private:
+        struct Control {
+            Dispose dispose = Dispose::None;
+            float delay = 0.1f;
+            int transparent = -1;
+        };
+
+        struct Frame {
+            Control control;
+            // As stored; may reach past the canvas
+            Region region;
+            // The part of `region` inside the canvas
+            Region visible;
+            bool interlaced = false;
+            std::pair<const uint8_t*, size_t> palette {};
+            uint8_t minCodeSize = 0;
+            // Offsets of the LZW sub-blocks
+            size_t data = 0;
+            size_t dataEnd = 0;
+        };
+
+        static bool skipSubBlocks(const uint8_t* data, size_t size, size_t& pos) {
+            while (pos < size) {
+                uint8_t length = data[pos++];
+                if (length == 0) return true;
+                if (size - pos < length) return false;
+                pos += length;
+            }
+            return false;
+        }
+
+        bool clip(Frame& frame) const {
+            auto& r = frame.region;
+            if (!r.width || !r.height || r.x >= m_canvas.width || r.y >= m_canvas.height) return false;
+            if (r.width > MAX_CANVAS_SIZE || r.height > MAX_CANVAS_SIZE) return false;
+            frame.visible = r;
+            frame.visible.width = std::min(r.width, m_canvas.width - r.x);
+            frame.visible.height = std::min(r.height, m_canvas.height - r.y);
+            return true;
+        }
+
+        // LZW-decodes the frame's colour indices into m_indices, one per pixel of
+        // its region. Streams that end early leave the rest at index 0.
+        bool decodeIndices(const Frame& frame) {
+            size_t total = size_t(frame.region.width) * frame.region.height;
+            m_indices.assign(total, 0);
+
+            const unsigned clear = 1u << frame.minCodeSize;
+            const unsigned end = clear + 1;
+            unsigned codeSize = frame.minCodeSize + 1;
+            unsigned next = clear + 2;
+            int previous = -1;
+            uint8_t first = 0;
+
+            uint32_t bits = 0;
+            unsigned count = 0;
+            size_t out = 0;
+            size_t pos = frame.data;
+            size_t blockLeft = 0;
+
+            while (out < total) {
+                while (count < codeSize) {
+                    if (blockLeft == 0) {
+                        if (pos >= frame.dataEnd) return true;
+                        blockLeft = m_data[pos++];
+                        if (blockLeft == 0) return true;
+                    }
+                    bits |= uint32_t(m_data[pos++]) << count;
+                    count += 8;
+                    blockLeft--;
+                }
+                unsigned code = bits & ((1u << codeSize) - 1);
+                bits >>= codeSize;
+                count -= codeSize;
+
+                if (code == clear) {
+                    codeSize = frame.minCodeSize + 1;
+                    next = clear + 2;
+                    previous = -1;
+                    continue;
+                }
+                if (code == end) return true;
+
+                if (previous < 0) {
+                    if (code >= clear) return false;
+                    m_indices[out++] = static_cast<uint8_t>(code);
+                    previous = static_cast<int>(code);
+                    first = static_cast<uint8_t>(code);
+                    continue;
+                }
+
+                // Walk the code's string backwards onto the stack
+                size_t depth = 0;
+                unsigned current = code;
+                if (code >= next) {
+                    if (code > next) return false;
+                    m_stack[depth++] = first;
+                    current = static_cast<unsigned>(previous);
+                }
+                while (current >= clear) {
+                    if (current >= next || depth >= 4095) return false;
+                    m_stack[depth++] = m_suffix[current];
+                    current = m_prefix[current];
+                }
+                first = static_cast<uint8_t>(current);
+                m_stack[depth++] = first;
+                while (depth && out < total) {
+                    m_indices[out++] = m_stack[--depth];
+                }
+
+                if (next < 4096) {
+                    m_prefix[next] = static_cast<uint16_t>(previous);
+                    m_suffix[next] = first;
+                    next++;
+                    if (next == (1u << codeSize) && codeSize < 12) codeSize++;
+                }
+                previous = static_cast<int>(code);
+            }
+            return true;
+        }
+
+        // Rows of an interlaced frame are stored in four passes
+        uint32_t sourceRow(const Frame& frame, uint32_t row) const {
+            if (!frame.interlaced) return row;
+            uint32_t height = frame.region.height;
+            uint32_t pass1 = (height + 7) / 8;
+            uint32_t pass2 = (height + 3) / 8;
+            uint32_t pass3 = (height + 1) / 4;
+            if (row % 8 == 0) return row / 8;
+            if (row % 8 == 4) return pass1 + row / 8;
+            if (row % 4 == 2) return pass1 + pass2 + row / 4;
+            return pass1 + pass2 + pass3 + row / 2;
+        }
+
+        void draw(const Frame& frame) {
+            auto* palette = frame.palette.first;
+            size_t entries = frame.palette.second;
+            int transparent = frame.control.transparent;
+
+            for (uint32_t y = 0; y < frame.visible.height; y++) {
+                auto* src = m_indices.data() + size_t(sourceRow(frame, y)) * frame.region.width;
+                auto* dst = m_canvas.pixels.data() + (size_t(frame.visible.y + y) * m_canvas.width + frame.visible.x) * 4;
+                for (uint32_t x = 0; x < frame.visible.width; x++, dst += 4) {
+                    unsigned index = src[x];
+                    if (static_cast<int>(index) == transparent || index >= entries) continue;
+                    dst[0] = palette[index * 3];
+                    dst[1] = palette[index * 3 + 1];
+                    dst[2] = palette[index * 3 + 2];
+                    dst[3] = 255;
+                }
+            }
+        }
+
+        const uint8_t* m_data = nullptr;
+        std::pair<const uint8_t*, size_t> m_globalPalette {};
+        std::vector<Frame> m_frames;
+        bool m_started = false;
+
+        std::vector<uint8_t> m_indices;
+        uint16_t m_prefix[4096];
+        uint8_t m_suffix[4096];
+        uint8_t m_stack[4096];
+    };
+}
+
+std::unique_ptr<FrameDecoder> openGif(const uint8_t* data, size_t size) {
+    return GifDecoder::open(data, size);
+}
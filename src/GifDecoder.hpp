@@ -0,0 +1,10 @@
+#pragma once
+
+#include "AnimatedImage.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// GIF87a/GIF89a frames with transparency, interlacing and all dispose modes.
+// Returns nullptr if the data isn't a GIF with at least one frame.
+std::unique_ptr<FrameDecoder> openGif(const uint8_t* data, size_t size);
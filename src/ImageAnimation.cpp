@@ -0,0 +1,166 @@
+#include "ImageAnimation.hpp"
+#include "ImageDecoder.hpp"
+#include "Trace.hpp"
+#include <Geode/utils/file.hpp>
+#include <algorithm>
+
+std::optional<SheetLayout> readSheetLayout(const std::filesystem::path& image) {
+    auto sheetPath = sheetPathFor(image);
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(sheetPath, ec)) return std::nullopt;
+
+    auto text = geode::utils::file::readString(sheetPath);
+    if (!text.isOk()) return std::nullopt;
+    auto parsed = matjson::parse(text.unwrap());
+    if (!parsed.isOk()) {
+        log::error("Invalid sprite sheet description: {}", sheetPath.string());
+        return std::nullopt;
+    }
+
+    auto json = parsed.unwrap();
+    SheetLayout layout;
+    layout.columns = static_cast<uint32_t>(std::max<intmax_t>(1, json["columns"].asInt().unwrapOr(1)));
+    layout.rows = static_cast<uint32_t>(std::max<intmax_t>(1, json["rows"].asInt().unwrapOr(1)));
+    auto cells = layout.columns * layout.rows;
+    layout.frames = static_cast<uint32_t>(std::clamp<intmax_t>(json["frames"].asInt().unwrapOr(cells), 1, cells));
+    layout.fps = static_cast<float>(std::max(0.1, json["fps"].asDouble().unwrapOr(12.0)));
+    return layout;
+}
+
+AnimationAction* AnimationAction::create(
+    const std::filesystem::path& path, CCTexture2D* poster, const AnimationInfo& info, float duration
+) {
+    auto ret = new AnimationAction();
+    ret->m_path = path;
+    ret->m_poster = poster;
+    ret->m_sheet = info.sheet;
+    ret->m_duration = duration;
+    ret->autorelease();
+    return ret;
+}
+
+CCRect AnimationAction::sheetFrameRect(CCTexture2D* sheet, const SheetLayout& layout, uint32_t frame) {
+    auto size = sheet->getContentSize();
+    float width = size.width / layout.columns;
+    float height = size.height / layout.rows;
+    return CCRect((frame % layout.columns) * width, (frame / layout.columns) * height, width, height);
+}
+
+void AnimationAction::startWithTarget(CCNode* target) {
+    CCAction::startWithTarget(target);
+    m_elapsed = 0;
+    m_done = false;
+    if (m_sheet) return;
+
+    // Frames come out the size the poster was shrunk to
+    m_stream = std::make_unique<FrameStream>(m_path, m_poster->getPixelsWide(), m_poster->getPixelsHigh());
+    m_frameEnd = 0;
+    m_pastPoster = false;
+}
+
+bool AnimationAction::isDone() {
+    return m_done;
+}
+
+void AnimationAction::stop() {
+    m_stream.reset();
+    m_textures[0] = nullptr;
+    m_textures[1] = nullptr;
+    CCAction::stop();
+}
+
+void AnimationAction::step(float dt) {
+    m_elapsed += dt;
+    if (m_duration > 0 && m_elapsed >= m_duration) {
+        m_done = true;
+        return;
+    }
+
+    if (m_sheet) {
+        auto frame = static_cast<uint32_t>(m_elapsed * m_sheet->fps) % m_sheet->frames;
+        if (frame != m_sheetFrame) {
+            m_sheetFrame = frame;
+            static_cast<CCSprite*>(m_pTarget)->setTextureRect(sheetFrameRect(m_poster, *m_sheet, frame));
+        }
+        return;
+    }
+    stepStream();
+}
+
+void AnimationAction::stepStream() {
+    if (!m_stream) return;
+
+    std::optional<StreamedFrame> latest;
+    while (m_elapsed >= m_frameEnd) {
+        auto frame = m_stream->pop();
+        if (!frame) {
+            // A decoder that fell behind holds the current frame rather than
+            // racing through the backlog once it catches up
+            if (m_elapsed - m_frameEnd > 0.25f) m_frameEnd = m_elapsed;
+            break;
+        }
+        m_frameEnd += frame->delay;
+        if (latest) m_stream->recycle(std::move(latest->image));
+        latest = std::move(frame);
+    }
+
+    if (latest) {
+        // The first frame is already up as the poster
+        if (m_pastPoster || latest->index != 0) upload(latest->image);
+        m_pastPoster = true;
+        m_stream->recycle(std::move(latest->image));
+    } else if (m_stream->failed()) {
+        log::error("Failed to decode animation frames: {}", m_path.string());
+        m_stream.reset();
+    }
+}
+
+void AnimationAction::upload(const DecodedImage& image) {
+    ScopedTrace trace(TracePhase::Upload);
+    auto& texture = m_textures[m_nextTexture];
+    m_nextTexture ^= 1;
+
+    if (!texture) {
+        auto* created = createTexture(image);
+        if (!created) return;
+        texture = created;
+        created->release();
+    } else {
+        ccGLBindTexture2D(texture->getName());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexSubImage2D(
+            GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data()
+        );
+    }
+
+    // setTexture resets the blend function, which the death image sets itself
+    auto* sprite = static_cast<CCSprite*>(m_pTarget);
+    auto blend = sprite->getBlendFunc();
+    sprite->setTexture(texture);
+    sprite->setBlendFunc(blend);
+}
+
+void setSpriteImage(CCSprite* sprite, const LoadHandle& handle, float duration) {
+    sprite->stopActionByTag(AnimationAction::TAG);
+
+    auto* texture = handle.texture();
+    auto& animation = handle.animation();
+    sprite->setTexture(texture);
+    if (animation && animation->sheet) {
+        sprite->setTextureRect(AnimationAction::sheetFrameRect(texture, *animation->sheet, 0));
+    } else {
+        sprite->setTextureRect(CCRect(CCPointZero, texture->getContentSize()));
+    }
+
+    if (animation) {
+        auto* action = AnimationAction::create(handle.path(), texture, *animation, duration);
+        action->setTag(AnimationAction::TAG);
+        sprite->runAction(action);
+    }
+}
+
+CCSprite* createImageSprite(const LoadHandle& handle, float duration) {
+    auto* sprite = CCSprite::createWithTexture(handle.texture());
+    if (sprite) setSpriteImage(sprite, handle, duration);
+    return sprite;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "AnimatedImage.hpp"
+#include "AsyncLoader.hpp"
+#include "FrameStream.hpp"
+#include <Geode/Geode.hpp>
+#include <filesystem>
+#include <memory>
+#include <optional>
+
+using namespace geode::prelude;
+
+// Reads `<name>.sheet.json` ({"columns", "rows", "frames", "fps"}) if there
+// is one next to `image`. Safe to call off the main thread.
+std::optional<SheetLayout> readSheetLayout(const std::filesystem::path& image);
+
+// Plays an animated image on the sprite it runs on, for `duration` seconds
+// or forever when that is 0. Sprite sheets step the texture rect through the
+// grid. APNGs and GIFs stream their frames through a FrameStream and upload
+// them into two textures of their own in turn, so nothing is created per frame.
+class AnimationAction : public CCAction {
+public:
+    static constexpr int TAG = 0x414e494d;
+
+    // `poster` is the loaded texture: the first frame, or the whole sheet
+    static AnimationAction* create(
+        const std::filesystem::path& path, CCTexture2D* poster, const AnimationInfo& info, float duration
+    );
+
+    void startWithTarget(CCNode* target) override;
+    void step(float dt) override;
+    bool isDone() override;
+    void stop() override;
+
+    // Texture rect of a sheet frame, in points
+    static CCRect sheetFrameRect(CCTexture2D* sheet, const SheetLayout& layout, uint32_t frame);
+
+private:
+    void stepStream();
+    void upload(const DecodedImage& image);
+
+    std::filesystem::path m_path;
+    Ref<CCTexture2D> m_poster;
+    std::optional<SheetLayout> m_sheet;
+    float m_duration = 0;
+    float m_elapsed = 0;
+    bool m_done = false;
+
+    uint32_t m_sheetFrame = 0;
+
+    std::unique_ptr<FrameStream> m_stream;
+    // When the frame on screen is due to be replaced
+    float m_frameEnd = 0;
+    bool m_pastPoster = false;
+    Ref<CCTexture2D> m_textures[2];
+    size_t m_nextTexture = 0;
+};
+
+// Puts a finished load on `sprite`, replacing its image and any animation it
+// was playing. Animated images get an AnimationAction for `duration` seconds
+// (0 plays forever).
+void setSpriteImage(CCSprite* sprite, const LoadHandle& handle, float duration);
+
+// A new sprite showing a finished load, set up like setSpriteImage()
+CCSprite* createImageSprite(const LoadHandle& handle, float duration);
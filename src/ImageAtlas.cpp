@@ -0,0 +1,344 @@
+#include "ImageAtlas.hpp"
+#include "AnimatedImage.hpp"
+#include "ImageDecoder.hpp"
+#include "ImageSize.hpp"
+#include "MappedFile.hpp"
+#include "Settings.hpp"
+#include "TextureCache.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace {
+    // Copies `image` into `page` at `rect` and repeats its outermost pixels into
+    // the border around it, so filtering never pulls in a neighbouring image
+    void blit(const DecodedImage& image, DecodedImage& page, const AtlasRect& rect) {
+        auto row = [&](uint32_t y) {
+            return page.pixels.data() + (static_cast<size_t>(y) * page.width + rect.x - 1) * 4;
+        };
+        size_t rowBytes = static_cast<size_t>(rect.width) * 4;
+        for (uint32_t y = 0; y < rect.height; y++) {
+            auto* dst = row(rect.y + y);
+            auto* src = image.pixels.data() + y * rowBytes;
+            std::memcpy(dst + 4, src, rowBytes);
+            std::memcpy(dst, src, 4);
+            std::memcpy(dst + 4 + rowBytes, src + rowBytes - 4, 4);
+        }
+        std::memcpy(row(rect.y - 1), row(rect.y), rowBytes + 8);
+        std::memcpy(row(rect.y + rect.height), row(rect.y + rect.height - 1), rowBytes + 8);
+    }
+}
+
+ImageAtlas* ImageAtlas::get() {
+    // Never released, like AsyncLoader
+    static auto* instance = new ImageAtlas();
+    return instance;
+}
+
+ImageAtlas::ImageAtlas() {
+    CCDirector::sharedDirector()->getScheduler()->scheduleUpdateForTarget(this, 0, false);
+}
+
+void ImageAtlas::refresh() {
+    auto& settings = Settings::get();
+    Source source;
+    if (settings.memeMode) {
+        source.memes = MemeManifest::get().snapshot();
+    } else if (settings.useCustomImage && settings.useFolder) {
+        source.folder = FolderIndex::get().snapshot();
+    }
+    // The TextureCache budget is set from the same setting
+    size_t budget = static_cast<size_t>(settings.textureCacheSize) * 1024 * 1024;
+    size_t maxPages = std::min(MAX_PAGES, budget / 2 / PAGE_BYTES);
+    if (source == m_source && maxPages == m_maxPages) return;
+    m_source = source;
+    m_maxPages = maxPages;
+
+    if (m_building) m_building->cancelled = true;
+    m_building = nullptr;
+    abandonUpload();
+    if ((!source.folder && !source.memes) || maxPages == 0) {
+        drop();
+        return;
+    }
+
+    m_building = std::make_shared<BuildState>();
+    std::thread(&ImageAtlas::pack, std::move(source), m_layout, maxPages, m_building).detach();
+}
+
+void ImageAtlas::abandonUpload() {
+    // A newer build is on its way, and it is planned against m_layout
+    m_uploading.reset();
+    m_uploaded.clear();
+    m_uploadedBytes = 0;
+    TextureCache::get().setReservedBytes(m_pageBytes);
+}
+
+void ImageAtlas::drop() {
+    abandonUpload();
+    m_layout = nullptr;
+    m_pages.clear();
+    m_frames.clear();
+    m_pageBytes = 0;
+    TextureCache::get().setReservedBytes(0);
+}
+
+CCSpriteFrame* ImageAtlas::frame(const std::filesystem::path& image) const {
+    auto it = m_frames.find(image.string());
+    return it != m_frames.end() ? it->second.data() : nullptr;
+}
+
+void ImageAtlas::measure(const std::filesystem::path& image, Slot& slot) {
+    slot.width = slot.height = 0;
+
+    // Animations keep their own textures to play from
+    std::error_code ec;
+    if (std::filesystem::exists(sheetPathFor(image), ec)) return;
+    auto file = MappedFile::open(image);
+    if (!file) return;
+    if (auto animation = openAnimation(file->data(), file->size()); animation && animation->animated()) return;
+    // Formats without a header readImageSize knows are left to AsyncLoader
+    auto size = readImageSize(file->data(), file->size());
+    if (!size) return;
+    auto [width, height] = *size;
+    if (!width || !height || width > MAX_IMAGE_SIZE || height > MAX_IMAGE_SIZE) return;
+    slot.width = width;
+    slot.height = height;
+}
+
+void ImageAtlas::pack(
+    Source source, std::shared_ptr<const Layout> previous, size_t maxPages, std::shared_ptr<BuildState> state
+) {
+    Trace::setThreadName("atlas");
+
+    std::vector<std::filesystem::path> images;
+    if (source.folder) {
+        images.reserve(source.folder->images.size());
+        for (auto& image : source.folder->images) {
+            images.push_back(image.imagePath);
+        }
+    } else if (source.memes) {
+        images.reserve(source.memes->size());
+        for (size_t i = 0; i < source.memes->size(); i++) {
+            images.push_back(source.memes->asset(i).imagePath);
+        }
+    }
+
+    // A previous page is kept while it still shows an image of the set,
+    // unless one of its images was edited or the budget lost room for it
+    size_t previousPages = previous ? previous->pages.size() : 0;
+    std::vector<bool> used(previousPages, false);
+    std::vector<bool> rebuilt(previousPages, false);
+    for (size_t page = maxPages; page < previousPages; page++) {
+        rebuilt[page] = true;
+    }
+
+    auto layout = std::make_shared<Layout>();
+    layout->images.reserve(images.size());
+    // Images that are new or changed, so nothing about them is known yet.
+    // Map nodes don't move, so these stay valid as the map grows.
+    std::vector<std::pair<const std::string*, Slot*>> unknown;
+    for (auto& image : images) {
+        if (state->cancelled) return;
+
+        Slot slot;
+        std::error_code ec;
+        auto size = std::filesystem::file_size(image, ec);
+        if (!ec) slot.stamp.size = size;
+        auto mtime = std::filesystem::last_write_time(image, ec);
+        if (!ec) slot.stamp.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+
+        auto path = image.string();
+        const Slot* old = nullptr;
+        if (previous) {
+            if (auto it = previous->images.find(path); it != previous->images.end()) old = &it->second;
+        }
+        bool same = old && old->stamp == slot.stamp;
+        if (same) {
+            slot = *old;
+            if (old->page != NO_PAGE) used[old->page] = true;
+        } else if (old && old->page != NO_PAGE) {
+            rebuilt[old->page] = true;
+        }
+
+        auto [it, inserted] = layout->images.emplace(std::move(path), slot);
+        if (inserted && !same) unknown.emplace_back(&it->first, &it->second);
+    }
+
+    Packed packed;
+    std::vector<size_t> renumbered(previousPages, NO_PAGE);
+    for (size_t page = 0; page < previousPages; page++) {
+        if (rebuilt[page] || !used[page]) continue;
+        renumbered[page] = layout->pages.size();
+        layout->pages.push_back(previous->pages[page]);
+        packed.pages.push_back({ page, {} });
+    }
+
+    // Only headers are read here; images too big to pack are never decoded
+    for (auto [path, slot] : unknown) {
+        if (state->cancelled) return;
+        measure(*path, *slot);
+    }
+
+    struct Candidate {
+        const std::string* path;
+        Slot* slot;
+    };
+    std::vector<Candidate> candidates;
+    for (auto& [path, slot] : layout->images) {
+        if (slot.page != NO_PAGE) {
+            slot.page = renumbered[slot.page];
+            if (slot.page != NO_PAGE) {
+                packed.placements.push_back({ path, slot.page, slot.rect, true });
+                continue;
+            }
+        }
+        if (slot.width) candidates.push_back({ &path, &slot });
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.slot->height > b.slot->height;
+    });
+
+    size_t firstNew = layout->pages.size();
+    size_t newPages = maxPages > firstNew ? maxPages - firstNew : 0;
+    std::vector<SkylinePacker> packers;
+    size_t firstPlacement = packed.placements.size();
+    for (auto& candidate : candidates) {
+        auto* slot = candidate.slot;
+        std::optional<AtlasRect> rect;
+        size_t page = 0;
+        for (; page < packers.size(); page++) {
+            if ((rect = packers[page].insert(slot->width + 2, slot->height + 2))) break;
+        }
+        if (!rect && packers.size() < newPages) {
+            packers.emplace_back(PAGE_SIZE, PAGE_SIZE);
+            rect = packers.back().insert(slot->width + 2, slot->height + 2);
+        }
+        if (!rect) continue;
+
+        slot->page = firstNew + page;
+        slot->rect = AtlasRect { rect->x + 1, rect->y + 1, slot->width, slot->height };
+        packed.placements.push_back({ *candidate.path, slot->page, slot->rect, false });
+    }
+
+    for (auto& packer : packers) {
+        layout->pages.push_back(packer.usedHeight());
+        PageBuild build;
+        build.pixels.width = PAGE_SIZE;
+        build.pixels.height = packer.usedHeight();
+        build.pixels.pixels.resize(static_cast<size_t>(PAGE_SIZE) * packer.usedHeight() * 4);
+        packed.pages.push_back(std::move(build));
+    }
+
+    auto placed = std::remove_if(
+        packed.placements.begin() + static_cast<std::ptrdiff_t>(firstPlacement), packed.placements.end(),
+        [&](const Placement& placement) {
+            if (state->cancelled) return true;
+
+            auto file = MappedFile::open(placement.path);
+            auto image = file ? decodeImage(file->data(), file->size()) : std::nullopt;
+            if (!image || image->width != placement.rect.width || image->height != placement.rect.height) {
+                // Changed since its header was read; it still loads on its own
+                auto& slot = layout->images[placement.path];
+                slot.page = NO_PAGE;
+                slot.width = slot.height = 0;
+                return true;
+            }
+
+            blit(*image, packed.pages[placement.page].pixels, placement.rect);
+            return false;
+        }
+    );
+    packed.placements.erase(placed, packed.placements.end());
+    if (state->cancelled) return;
+
+    if (!packers.empty()) {
+        log::info(
+            "Packed {} of {} images into {} atlas pages, {} of them kept",
+            packed.placements.size(), images.size(), layout->pages.size(), firstNew
+        );
+    }
+    packed.layout = std::move(layout);
+    std::lock_guard lock(state->mutex);
+    state->result = std::move(packed);
+}
+
+void ImageAtlas::update(float) {
+    if (m_building) {
+        std::optional<Packed> result;
+        {
+            std::lock_guard lock(m_building->mutex);
+            result.swap(m_building->result);
+        }
+        if (!result) return;
+        m_building = nullptr;
+        m_uploading = std::move(result);
+    }
+    if (!m_uploading) return;
+
+    // One new page per frame, so no single frame pays for more than one upload
+    auto& pages = m_uploading->pages;
+    while (m_uploaded.size() < pages.size()) {
+        auto& page = pages[m_uploaded.size()];
+        if (page.keep) {
+            m_uploaded.push_back(m_pages[*page.keep]);
+            continue;
+        }
+
+        ScopedTrace trace(TracePhase::Upload);
+        auto* texture = createTexture(page.pixels);
+        if (!texture) {
+            log::error("Failed to upload atlas page");
+            drop();
+            return;
+        }
+        m_uploaded.push_back(texture);
+        texture->release();
+        m_uploadedBytes += static_cast<size_t>(page.pixels.width) * page.pixels.height * 4;
+        TextureCache::get().setReservedBytes(m_pageBytes + m_uploadedBytes);
+        page.pixels = {};
+        return;
+    }
+
+    // Everything is up, so switch over in one go
+    std::unordered_map<std::string, Ref<CCSpriteFrame>> frames;
+    frames.reserve(m_uploading->placements.size());
+    for (auto& placement : m_uploading->placements) {
+        if (placement.kept) {
+            if (auto it = m_frames.find(placement.path); it != m_frames.end()) {
+                frames.emplace(placement.path, it->second);
+                continue;
+            }
+        }
+        auto& rect = placement.rect;
+        auto points = CC_RECT_PIXELS_TO_POINTS(CCRect(
+            static_cast<float>(rect.x), static_cast<float>(rect.y),
+            static_cast<float>(rect.width), static_cast<float>(rect.height)
+        ));
+        frames.emplace(placement.path, CCSpriteFrame::createWithTexture(m_uploaded[placement.page], points));
+    }
+    m_frames = std::move(frames);
+    m_pages = std::move(m_uploaded);
+    m_uploaded.clear();
+    m_layout = std::move(m_uploading->layout);
+    m_uploading.reset();
+
+    m_pageBytes = 0;
+    for (auto height : m_layout->pages) {
+        m_pageBytes += static_cast<size_t>(PAGE_SIZE) * height * 4;
+    }
+    m_uploadedBytes = 0;
+    TextureCache::get().setReservedBytes(m_pageBytes);
+}
+
+$on_mod(Loaded) {
+    Settings::listen([](const Settings& settings, const Settings* previous) {
+        if (!previous) return;
+        if (settings.memeMode == previous->memeMode && settings.useCustomImage == previous->useCustomImage
+            && settings.useFolder == previous->useFolder && settings.textureCacheSize == previous->textureCacheSize) {
+            return;
+        }
+        ImageAtlas::get()->refresh();
+    });
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "AtlasPacker.hpp"
+#include "DecodedImage.hpp"
+#include "FolderIndex.hpp"
+#include "MemeManifest.hpp"
+#include <Geode/Geode.hpp>
+#include <atomic>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace geode::prelude;
+
+// Packs the small images of the meme or folder set in use into a few shared
+// pages, so showing one is a sprite frame lookup instead of a file load and a
+// texture upload. Images bigger than MAX_IMAGE_SIZE, or that don't fit in the
+// pages, keep going through AsyncLoader. The pages count against the
+// TextureCache budget, and may take at most half of it.
+//
+// The set is repacked on a background thread each time FolderIndex or
+// MemeManifest publishes a snapshot. Pages whose images are all unchanged are
+// kept as they are; only pages holding an edited image are rebuilt, and new
+// images go into new pages while there is room for them.
+class ImageAtlas : public CCObject {
+public:
+    static constexpr uint32_t PAGE_SIZE = 2048;
+    static constexpr size_t PAGE_BYTES = size_t(PAGE_SIZE) * PAGE_SIZE * 4;
+    static constexpr uint32_t MAX_IMAGE_SIZE = 512;
+    static constexpr size_t MAX_PAGES = 4;
+
+    static ImageAtlas* get();
+
+    // Repacks from the snapshot the current mode draws from, unless that is
+    // the one packed already. Main thread only.
+    void refresh();
+
+    // Frame for `image` once its page is uploaded, otherwise nullptr
+    CCSpriteFrame* frame(const std::filesystem::path& image) const;
+
+    void update(float dt) override;
+
+private:
+    static constexpr size_t NO_PAGE = std::numeric_limits<size_t>::max();
+
+    struct Source {
+        std::shared_ptr<const FolderSnapshot> folder;
+        std::shared_ptr<const MemeTable> memes;
+
+        bool operator==(const Source&) const = default;
+    };
+
+    struct Stamp {
+        int64_t mtime = 0;
+        uint64_t size = 0;
+
+        bool operator==(const Stamp&) const = default;
+    };
+
+    // What the last pack found out about one image of the set
+    struct Slot {
+        Stamp stamp;
+        // 0 when the image can't be packed (too big, animated, unreadable)
+        uint32_t width = 0;
+        uint32_t height = 0;
+        size_t page = NO_PAGE;
+        // Inside the 1px border copied from the image's edges
+        AtlasRect rect;
+    };
+
+    // Immutable once built, so the next pack can read it from its thread
+    struct Layout {
+        // Keyed by path. Images that can't be packed are kept too, so they
+        // aren't read again until they change.
+        std::unordered_map<std::string, Slot> images;
+        // Used height of each page
+        std::vector<uint32_t> pages;
+    };
+
+    struct Placement {
+        std::string path;
+        size_t page;
+        AtlasRect rect;
+        // On a page kept from the previous layout, whose frame still works
+        bool kept;
+    };
+
+    struct PageBuild {
+        // Page of the previous layout to reuse, or nullopt to upload `pixels`
+        std::optional<size_t> keep;
+        DecodedImage pixels;
+    };
+
+    struct Packed {
+        std::shared_ptr<const Layout> layout;
+        std::vector<PageBuild> pages;
+        std::vector<Placement> placements;
+    };
+
+    struct BuildState {
+        std::atomic<bool> cancelled = false;
+        std::mutex mutex;
+        std::optional<Packed> result;
+    };
+
+    ImageAtlas();
+    static void pack(
+        Source source, std::shared_ptr<const Layout> previous, size_t maxPages, std::shared_ptr<BuildState> state
+    );
+    static void measure(const std::filesystem::path& image, Slot& slot);
+    void abandonUpload();
+    void drop();
+
+    Source m_source;
+    size_t m_maxPages = 0;
+    std::shared_ptr<BuildState> m_building;
+    // Built but not switched to yet; one new page goes up per frame
+    std::optional<Packed> m_uploading;
+    std::vector<Ref<CCTexture2D>> m_uploaded;
+    size_t m_uploadedBytes = 0;
+
+    // What is in use: m_pages and m_frames always match m_layout
+    std::shared_ptr<const Layout> m_layout;
+    std::vector<Ref<CCTexture2D>> m_pages;
+    size_t m_pageBytes = 0;
+    std::unordered_map<std::string, Ref<CCSpriteFrame>> m_frames;
+};
@@ -0,0 +1,129 @@
+#include "ImageDecoder.hpp"
+#include "PngDecoder.hpp"
+#include "Resample.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // initWithData always marks textures as straight alpha, but our pixels are
+    // premultiplied like the ones initWithImage gets from CCImage
+    class PremultipliedTexture : public CCTexture2D {
+    public:
+        bool initWithPixels(const void* pixels, CCTexture2DPixelFormat format, uint32_t width, uint32_t height) {
+            if (!this->initWithData(
+                pixels, format, width, height,
+                CCSizeMake(static_cast<float>(width), static_cast<float>(height))
+            )) {
+                return false;
+            }
+            m_bHasPremultipliedAlpha = true;
+            return true;
+        }
+    };
+
+    CCTexture2D* uploadPixels(const void* pixels, CCTexture2DPixelFormat format, uint32_t width, uint32_t height, bool mipmaps) {
+        auto* texture = new PremultipliedTexture();
+        if (!texture->initWithPixels(pixels, format, width, height)) {
+            texture->release();
+            return nullptr;
+        }
+
+        // GLES2 can only mipmap power-of-two textures; desktop GL takes any size
+#ifdef GEODE_IS_DESKTOP
+        bool canMipmap = true;
+#else
+        bool canMipmap = (width & (width - 1)) == 0 && (height & (height - 1)) == 0;
+#endif
+        if (mipmaps && canMipmap) {
+            texture->generateMipmap();
+            ccTexParams params = { GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE };
+            texture->setTexParameters(&params);
+        }
+        return texture;
+    }
+}
+
+std::optional<DecodedImage> decodeImage(const uint8_t* data, size_t size) {
+    if (auto png = decodePng(data, size)) {
+        return png;
+    }
+
+    // Other formats (and the PNG variants decodePng skips) go through cocos
+    auto* image = new CCImage();
+    if (!image->initWithImageData(
+        static_cast<void*>(const_cast<uint8_t*>(data)),
+        static_cast<int>(size)
+    )) {
+        image->release();
+        return std::nullopt;
+    }
+
+    DecodedImage decoded;
+    decoded.width = image->getWidth();
+    decoded.height = image->getHeight();
+
+    size_t pixelCount = static_cast<size_t>(decoded.width) * decoded.height;
+    auto* src = image->getData();
+
+    if (image->hasAlpha()) {
+        decoded.pixels.assign(src, src + pixelCount * 4);
+    } else {
+        decoded.pixels.resize(pixelCount * 4);
+        auto* dst = decoded.pixels.data();
+        for (size_t i = 0; i < pixelCount; i++) {
+            dst[i * 4 + 0] = src[i * 3 + 0];
+            dst[i * 4 + 1] = src[i * 3 + 1];
+            dst[i * 4 + 2] = src[i * 3 + 2];
+            dst[i * 4 + 3] = 255;
+        }
+    }
+
+    image->release();
+    return decoded;
+}
+
+ImageTarget screenTarget() {
+    auto size = CCDirector::sharedDirector()->getWinSizeInPixels();
+    return { static_cast<uint32_t>(std::ceil(size.width)), static_cast<uint32_t>(std::ceil(size.height)) };
+}
+
+std::pair<uint32_t, uint32_t> fittedSize(uint32_t width, uint32_t height, const ImageTarget& target) {
+    if (!width || !height || (!target.width && !target.height)) return { width, height };
+
+    // The smallest scale that still covers both target sides
+    double scale = std::max(
+        static_cast<double>(target.width) / width,
+        static_cast<double>(target.height) / height
+    );
+    if (scale >= 1.0) return { width, height };
+
+    auto fittedWidth = std::max<uint32_t>(1, static_cast<uint32_t>(std::ceil(width * scale)));
+    auto fittedHeight = std::max<uint32_t>(1, static_cast<uint32_t>(std::ceil(height * scale)));
+    if (fittedWidth >= width && fittedHeight >= height) return { width, height };
+    return { fittedWidth, fittedHeight };
+}
+
+void fitToTarget(DecodedImage& image, const ImageTarget& target) {
+    auto [width, height] = fittedSize(image.width, image.height, target);
+    if (width == image.width && height == image.height) return;
+
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+    resampleArea(image.pixels.data(), image.width, image.height, pixels.data(), width, height);
+    image.pixels = std::move(pixels);
+    image.width = width;
+    image.height = height;
+}
+
+CCTexture2D* createTexture(const DecodedImage& image, bool mipmaps) {
+    return uploadPixels(image.pixels.data(), kCCTexture2DPixelFormat_RGBA8888, image.width, image.height, mipmaps);
+}
+
+CCTexture2D* createTexture(const BakedImageView& image, bool mipmaps) {
+    CCTexture2DPixelFormat format = kCCTexture2DPixelFormat_RGBA8888;
+    if (image.format == BakedFormat::RGB565) {
+        format = kCCTexture2DPixelFormat_RGB565;
+    } else if (image.format == BakedFormat::RGBA4444) {
+        format = kCCTexture2DPixelFormat_RGBA4444;
+    }
+    return uploadPixels(image.pixels, format, image.width, image.height, mipmaps);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "BakedImage.hpp"
+#include "DecodedImage.hpp"
+#include <Geode/Geode.hpp>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+using namespace geode::prelude;
+
+// The size an image is going to be drawn at, in pixels. Larger images are
+// shrunk (keeping their aspect ratio) until one side reaches its target, so
+// the image still covers a width x height box. A zero side is unconstrained.
+struct ImageTarget {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // Build a mip chain, for images that get drawn much smaller than the target
+    bool mipmaps = false;
+
+    bool operator==(const ImageTarget&) const = default;
+};
+
+// Covers the whole screen, for death images. Main thread only.
+ImageTarget screenTarget();
+
+// Decodes an encoded image into RGBA pixels, using decodePng when it can and
+// CCImage otherwise. Safe to call off the main thread.
+std::optional<DecodedImage> decodeImage(const uint8_t* data, size_t size);
+
+// The size fitToTarget shrinks a width x height image to, or the same size
+// when it is already within `target`.
+std::pair<uint32_t, uint32_t> fittedSize(uint32_t width, uint32_t height, const ImageTarget& target);
+
+// Area-averages `image` down to `target`. Images already within it are left alone.
+void fitToTarget(DecodedImage& image, const ImageTarget& target);
+
+// Uploads decoded pixels into a new texture. Main thread only; the caller owns
+// the returned reference.
+CCTexture2D* createTexture(const DecodedImage& image, bool mipmaps = false);
+
+// Uploads a baked image straight from its (mapped) pixels, in its own format.
+CCTexture2D* createTexture(const BakedImageView& image, bool mipmaps = false);
@@ -0,0 +1,308 @@
+#include "ImageGallery.hpp"
+#include "FolderIndex.hpp"
+#include "ImageDecoder.hpp"
+#include "MemeManifest.hpp"
+#include "Settings.hpp"
+#include "ThumbnailCache.hpp"
+#include <Geode/modify/PauseLayer.hpp>
+#include <Geode/ui/BasedButtonSprite.hpp>
+#include <algorithm>
+#include <cmath>
+
+GalleryCell* GalleryCell::create(const CCSize& size) {
+    auto ret = new GalleryCell();
+    if (ret->init(size)) {
+        ret->autorelease();
+        return ret;
+    }
+    delete ret;
+    return nullptr;
+}
+
+bool GalleryCell::init(const CCSize& size) {
+    if (!CCNode::init()) return false;
+    setContentSize(size);
+    setAnchorPoint({ 0.5f, 0.5f });
+
+    auto bg = CCLayerColor::create({ 0, 0, 0, 80 }, size.width - 4, size.height - 4);
+    bg->setPosition({ 2, 2 });
+    addChild(bg);
+
+    m_label = CCLabelBMFont::create("", "chatFont.fnt");
+    m_label->setScale(0.45f);
+    m_label->setPosition({ size.width / 2, 9 });
+    addChild(m_label, 1);
+    return true;
+}
+
+void GalleryCell::show(const std::filesystem::path& path) {
+    clear();
+    m_path = path;
+    setVisible(true);
+
+    auto name = path.stem().string();
+    if (name.size() > 14) name = name.substr(0, 13) + "...";
+    m_label->setString(name.c_str());
+
+    uint32_t serial = m_serial;
+    Ref<GalleryCell> self = this;
+    ThumbnailCache::get().request(path, [this, self, serial](std::shared_ptr<const DecodedImage> thumbnail) {
+        if (m_serial != serial || !thumbnail) return;
+        setThumbnail(*thumbnail);
+    });
+}
+
+void GalleryCell::clear() {
+    m_serial++;
+    m_path.clear();
+    if (m_sprite) {
+        m_sprite->removeFromParent();
+        m_sprite = nullptr;
+    }
+}
+
+void GalleryCell::setThumbnail(const DecodedImage& thumbnail) {
+    auto* texture = createTexture(thumbnail);
+    if (!texture) return;
+    m_sprite = CCSprite::createWithTexture(texture);
+    texture->release();
+
+    // Fit the box above the label
+    auto size = getContentSize();
+    float box = std::min(size.width - 10, size.height - 24);
+    auto spriteSize = m_sprite->getContentSize();
+    m_sprite->setScale(box / std::max(spriteSize.width, spriteSize.height));
+    m_sprite->setPosition({ size.width / 2, 18 + box / 2 });
+    addChild(m_sprite);
+}
+
+GalleryGrid* GalleryGrid::create(const CCSize& size) {
+    auto ret = new GalleryGrid();
+    if (ret->init(size)) {
+        ret->autorelease();
+        return ret;
+    }
+    delete ret;
+    return nullptr;
+}
+
+bool GalleryGrid::init(const CCSize& size) {
+    if (!CCNode::init()) return false;
+    setContentSize(size);
+    m_columns = std::max<size_t>(1, static_cast<size_t>(size.width / CELL_WIDTH));
+
+    m_scroll = ScrollLayer::create(size);
+    addChild(m_scroll);
+    scheduleUpdate();
+    return true;
+}
+
+void GalleryGrid::setImages(std::vector<std::filesystem::path> images) {
+    auto* content = m_scroll->m_contentLayer;
+    auto viewHeight = getContentSize().height;
+    float oldHeight = content->getContentSize().height;
+    // Distance scrolled down from the top
+    float scrolled = oldHeight - viewHeight + content->getPositionY();
+
+    for (auto& [index, cell] : m_cells) {
+        cell->clear();
+        cell->setVisible(false);
+        m_spare.push_back(cell);
+    }
+    m_cells.clear();
+    m_images = std::move(images);
+
+    size_t rows = (m_images.size() + m_columns - 1) / m_columns;
+    float height = std::max(viewHeight, static_cast<float>(rows) * CELL_HEIGHT);
+    content->setContentSize({ getContentSize().width, height });
+    scrolled = std::clamp(scrolled, 0.0f, height - viewHeight);
+    content->setPositionY(viewHeight - height + scrolled);
+    layout(true);
+}
+
+void GalleryGrid::update(float) {
+    layout(false);
+}
+
+GalleryCell* GalleryGrid::takeCell() {
+    if (!m_spare.empty()) {
+        auto* cell = m_spare.back();
+        m_spare.pop_back();
+        return cell;
+    }
+    auto* cell = GalleryCell::create({ CELL_WIDTH, CELL_HEIGHT });
+    m_scroll->m_contentLayer->addChild(cell);
+    return cell;
+}
+
+void GalleryGrid::layout(bool force) {
+    auto* content = m_scroll->m_contentLayer;
+    float height = content->getContentSize().height;
+    float viewHeight = getContentSize().height;
+    float bottom = -content->getPositionY();
+
+    int rows = static_cast<int>((m_images.size() + m_columns - 1) / m_columns);
+    int first = std::max(0, static_cast<int>(std::floor((height - bottom - viewHeight) / CELL_HEIGHT)) - 1);
+    int last = std::min(rows - 1, static_cast<int>(std::floor((height - bottom) / CELL_HEIGHT)) + 1);
+    if (!force && first == m_firstRow && last == m_lastRow) return;
+    m_firstRow = first;
+    m_lastRow = last;
+
+    size_t begin = static_cast<size_t>(first) * m_columns;
+    size_t end = last < first ? begin : std::min(m_images.size(), static_cast<size_t>(last + 1) * m_columns);
+
+    for (auto it = m_cells.begin(); it != m_cells.end();) {
+        if (it->first >= begin && it->first < end) {
+            ++it;
+            continue;
+        }
+        it->second->clear();
+        it->second->setVisible(false);
+        m_spare.push_back(it->second);
+        it = m_cells.erase(it);
+    }
+
+    float margin = (getContentSize().width - static_cast<float>(m_columns) * CELL_WIDTH) / 2;
+    for (size_t index = begin; index < end; index++) {
+        if (m_cells.contains(index)) continue;
+        auto* cell = takeCell();
+        auto row = static_cast<float>(index / m_columns);
+        auto column = static_cast<float>(index % m_columns);
+        cell->setPosition({ margin + (column + 0.5f) * CELL_WIDTH, height - (row + 0.5f) * CELL_HEIGHT });
+        cell->show(m_images[index]);
+        m_cells[index] = cell;
+    }
+}
+
+ImageGallery* ImageGallery::create(DeathSource source) {
+    auto ret = new ImageGallery();
+    if (ret->initAnchored(420.f, 290.f, source)) {
+        ret->autorelease();
+        return ret;
+    }
+    delete ret;
+    return nullptr;
+}
+
+bool ImageGallery::setup(DeathSource source) {
+    setTitle("Death Images");
+
+    m_folderTab = CCMenuItemSpriteExtra::create(
+        ButtonSprite::create("Folder", "bigFont.fnt", "GJ_button_01.png", 0.6f), this, menu_selector(ImageGallery::onTab)
+    );
+    m_folderTab->setTag(static_cast<int>(DeathSource::Folder));
+    m_buttonMenu->addChildAtPosition(m_folderTab, Anchor::Top, { -50, -44 });
+
+    m_memesTab = CCMenuItemSpriteExtra::create(
+        ButtonSprite::create("Memes", "bigFont.fnt", "GJ_button_01.png", 0.6f), this, menu_selector(ImageGallery::onTab)
+    );
+    m_memesTab->setTag(static_cast<int>(DeathSource::Memes));
+    m_buttonMenu->addChildAtPosition(m_memesTab, Anchor::Top, { 50, -44 });
+
+    CCSize gridSize { m_size.width - 30, m_size.height - 80 };
+    m_grid = GalleryGrid::create(gridSize);
+    m_grid->setPosition({ 15, 12 });
+    m_mainLayer->addChild(m_grid);
+
+    m_status = CCLabelBMFont::create("", "bigFont.fnt");
+    m_status->setScale(0.4f);
+    m_status->setPosition({ m_size.width / 2, 12 + gridSize.height / 2 });
+    m_mainLayer->addChild(m_status, 1);
+
+    showSource(source);
+    scheduleUpdate();
+    return true;
+}
+
+void ImageGallery::onTab(CCObject* sender) {
+    showSource(static_cast<DeathSource>(sender->getTag()));
+}
+
+void ImageGallery::showSource(DeathSource source) {
+    m_source = source;
+    m_folder = nullptr;
+    m_memes = nullptr;
+    ThumbnailCache::get().cancelPending();
+
+    auto select = [](CCMenuItemSpriteExtra* tab, bool selected) {
+        static_cast<ButtonSprite*>(tab->getNormalImage())->updateBGImage(selected ? "GJ_button_01.png" : "GJ_button_04.png");
+    };
+    select(m_folderTab, source == DeathSource::Folder);
+    select(m_memesTab, source == DeathSource::Memes);
+
+    m_grid->setImages({});
+    refresh();
+}
+
+void ImageGallery::update(float) {
+    refresh();
+}
+
+void ImageGallery::refresh() {
+    std::vector<std::filesystem::path> images;
+    if (m_source == DeathSource::Folder) {
+        auto folder = FolderIndex::get().snapshot();
+        if (!folder) {
+            auto progress = FolderIndex::get().progress();
+            if (progress.scanning) {
+                m_status->setString(fmt::format("Indexing images... {} files", progress.files).c_str());
+            } else {
+                m_status->setString(Settings::get().useFolder ? "No custom folder set" : "Image folder is turned off");
+            }
+            return;
+        }
+        if (folder == m_folder) return;
+        m_folder = folder;
+
+        images.reserve(folder->images.size());
+        for (auto& image : folder->images) {
+            images.push_back(image.imagePath);
+        }
+    } else {
+        auto memes = MemeManifest::get().snapshot();
+        if (!memes) {
+            m_status->setString("Loading memes...");
+            return;
+        }
+        if (memes == m_memes) return;
+        m_memes = memes;
+
+        // A stem with both sounds is listed twice, one after the other
+        for (size_t i = 0; i < memes->size(); i++) {
+            auto imagePath = memes->asset(i).imagePath;
+            if (images.empty() || images.back() != imagePath) images.push_back(std::move(imagePath));
+        }
+    }
+
+    m_status->setString(images.empty() ? "No images found" : "");
+    m_grid->setImages(std::move(images));
+}
+
+void ImageGallery::onClose(CCObject* sender) {
+    ThumbnailCache::get().cancelPending();
+    Popup::onClose(sender);
+}
+
+class $modify(GalleryPauseLayer, PauseLayer) {
+    void customSetup() {
+        PauseLayer::customSetup();
+
+        auto menu = getChildByID("right-button-menu");
+        if (!menu) return;
+
+        auto button = CCMenuItemSpriteExtra::create(
+            CircleButtonSprite::createWithSprite("logo.png"_spr, 1.1f, CircleBaseColor::Green, CircleBaseSize::MediumAlt),
+            this, menu_selector(GalleryPauseLayer::onDeathGallery)
+        );
+        button->setID("death-gallery-button"_spr);
+        menu->addChild(button);
+        menu->updateLayout();
+    }
+
+    void onDeathGallery(CCObject*) {
+        auto source = Settings::get().memeMode ? DeathSource::Memes : DeathSource::Folder;
+        if (auto gallery = ImageGallery::create(source)) {
+            gallery->show();
+        }
+    }
+};
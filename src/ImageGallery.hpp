@@ -0,0 +1,89 @@
+#pragma once
+
+#include "DeathQueue.hpp"
+#include <Geode/Geode.hpp>
+#include <Geode/ui/Popup.hpp>
+#include <Geode/ui/ScrollLayer.hpp>
+#include <filesystem>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+using namespace geode::prelude;
+
+// One image in the gallery. Cells are reused as the grid scrolls, so a
+// thumbnail that arrives for an image the cell no longer shows is dropped.
+class GalleryCell : public CCNode {
+public:
+    static GalleryCell* create(const CCSize& size);
+
+    void show(const std::filesystem::path& path);
+    void clear();
+
+private:
+    bool init(const CCSize& size);
+    void setThumbnail(const DecodedImage& thumbnail);
+
+    std::filesystem::path m_path;
+    // Bumped on every show(), so late thumbnails can tell they're stale
+    uint32_t m_serial = 0;
+    CCLabelBMFont* m_label = nullptr;
+    CCSprite* m_sprite = nullptr;
+};
+
+// Scrolling grid that only has nodes for the rows in view (and one either
+// side). Cells scrolled out are recycled for the rows scrolling in, so a
+// folder of 10k images costs as many nodes as one of 20.
+class GalleryGrid : public CCNode {
+public:
+    static constexpr float CELL_WIDTH = 74;
+    static constexpr float CELL_HEIGHT = 84;
+
+    static GalleryGrid* create(const CCSize& size);
+
+    // Keeps the scroll position where it can, so a folder that changes while
+    // it's open doesn't jump back to the top
+    void setImages(std::vector<std::filesystem::path> images);
+
+    void update(float dt) override;
+
+private:
+    bool init(const CCSize& size);
+    void layout(bool force);
+    GalleryCell* takeCell();
+
+    ScrollLayer* m_scroll = nullptr;
+    std::vector<std::filesystem::path> m_images;
+    size_t m_columns = 1;
+    // Cells in use, by image index
+    std::unordered_map<size_t, GalleryCell*> m_cells;
+    std::vector<GalleryCell*> m_spare;
+    int m_firstRow = -1;
+    int m_lastRow = -1;
+};
+
+// Browses the custom folder or the meme set from inside the game
+class ImageGallery : public geode::Popup<DeathSource> {
+public:
+    static ImageGallery* create(DeathSource source);
+
+    void update(float dt) override;
+
+protected:
+    bool setup(DeathSource source) override;
+    void onClose(CCObject* sender) override;
+
+private:
+    void onTab(CCObject* sender);
+    void showSource(DeathSource source);
+    void refresh();
+
+    DeathSource m_source = DeathSource::Folder;
+    GalleryGrid* m_grid = nullptr;
+    CCLabelBMFont* m_status = nullptr;
+    CCMenuItemSpriteExtra* m_folderTab = nullptr;
+    CCMenuItemSpriteExtra* m_memesTab = nullptr;
+    // What the grid shows now, so refresh() only rebuilds it when they change
+    std::shared_ptr<const FolderSnapshot> m_folder;
+    std::shared_ptr<const MemeTable> m_memes;
+};
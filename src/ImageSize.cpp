@@ -0,0 +1,56 @@
+#include "ImageSize.hpp"
+#include "PngDecoder.hpp"
+#include <cstring>
+
+namespace {
+    uint16_t readU16BE(const uint8_t* p) {
+        return static_cast<uint16_t>(p[0] << 8 | p[1]);
+    }
+
+    uint16_t readU16LE(const uint8_t* p) {
+        return static_cast<uint16_t>(p[0] | p[1] << 8);
+    }
+
+    std::optional<std::pair<uint32_t, uint32_t>> readJpegSize(const uint8_t* data, size_t size) {
+        if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) return std::nullopt;
+
+        size_t pos = 2;
+        while (pos + 4 <= size) {
+            if (data[pos] != 0xFF) return std::nullopt;
+            uint8_t marker = data[pos + 1];
+            if (marker == 0xFF) {
+                // Fill byte before the marker
+                pos++;
+                continue;
+            }
+            pos += 2;
+            // Markers without a length
+            if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) continue;
+            if (marker == 0xD9 || marker == 0xDA) return std::nullopt;
+
+            uint16_t length = readU16BE(data + pos);
+            if (length < 2 || pos + length > size) return std::nullopt;
+            // Frame headers: every SOFn except DHT, JPG and DAC, which share the range
+            bool frame = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+            if (frame) {
+                if (length < 7) return std::nullopt;
+                return std::make_pair<uint32_t, uint32_t>(readU16BE(data + pos + 5), readU16BE(data + pos + 3));
+            }
+            pos += length;
+        }
+        return std::nullopt;
+    }
+
+    std::optional<std::pair<uint32_t, uint32_t>> readGifSize(const uint8_t* data, size_t size) {
+        if (size < 10 || (std::memcmp(data, "GIF87a", 6) != 0 && std::memcmp(data, "GIF89a", 6) != 0)) {
+            return std::nullopt;
+        }
+        return std::make_pair<uint32_t, uint32_t>(readU16LE(data + 6), readU16LE(data + 8));
+    }
+}
+
+std::optional<std::pair<uint32_t, uint32_t>> readImageSize(const uint8_t* data, size_t size) {
+    if (auto png = readPngSize(data, size)) return png;
+    if (auto jpeg = readJpegSize(data, size)) return jpeg;
+    return readGifSize(data, size);
+}
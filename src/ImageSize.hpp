@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+// Width and height of a PNG, JPEG or GIF from its headers, without decoding
+// any pixels. Returns nullopt for anything else. For a JPEG this walks the
+// markers up to the first frame header, so pass the whole file.
+std::optional<std::pair<uint32_t, uint32_t>> readImageSize(const uint8_t* data, size_t size);
@@ -0,0 +1,318 @@
+#include "Inflate.hpp"
+#include <cstring>
+
+namespace {
+    constexpr int MAX_BITS = 15;
+    constexpr int LITLEN_TABLE_BITS = 10;
+    constexpr int DIST_TABLE_BITS = 8;
+    constexpr int CODELEN_TABLE_BITS = 7;
+
+    constexpr uint16_t LENGTH_BASE[29] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+    };
+    constexpr uint8_t LENGTH_EXTRA[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+    };
+    constexpr uint16_t DIST_BASE[30] = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+    };
+    constexpr uint8_t DIST_EXTRA[30] = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+    };
+    constexpr uint8_t CODELEN_ORDER[19] = {
+        16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15,
+    };
+
+    // LSB-first bit buffer that keeps at least 56 bits loaded after refill(),
+    // enough for a whole length/distance pair
+    class BitReader {
+    public:
+        BitReader(const uint8_t* data, size_t size) : m_pos(data), m_end(data + size) {}
+
+        void refill() {
+            if (m_end - m_pos >= 8) {
+                uint64_t word;
+                std::memcpy(&word, m_pos, 8);
+                m_bits |= word << m_count;
+                m_pos += (63 - m_count) >> 3;
+                m_count |= 56;
+                return;
+            }
+            while (m_count <= 56) {
+                if (m_pos < m_end) {
+                    m_bits |= uint64_t(*m_pos++) << m_count;
+                } else {
+                    m_padding += 8;
+                }
+                m_count += 8;
+            }
+        }
+
+        uint64_t peek() const { return m_bits; }
+        void consume(unsigned count) {
+            m_bits >>= count;
+            m_count -= count;
+        }
+        uint32_t get(unsigned count) {
+            auto value = static_cast<uint32_t>(m_bits & ((uint64_t(1) << count) - 1));
+            consume(count);
+            return value;
+        }
+
+        void alignToByte() { consume(m_count & 7); }
+        bool copyBytes(uint8_t* dst, size_t count) {
+            while (count && m_count >= 8) {
+                *dst++ = static_cast<uint8_t>(get(8));
+                count--;
+            }
+            if (count == 0) return true;
+
+            // refill() may have left copies of the upcoming bytes above m_count
+            m_bits = 0;
+            if (count > static_cast<size_t>(m_end - m_pos)) return false;
+            std::memcpy(dst, m_pos, count);
+            m_pos += count;
+            return true;
+        }
+
+        // True once bits past the end of the input have been used
+        bool overrun() const { return m_padding > m_count; }
+
+    private:
+        const uint8_t* m_pos;
+        const uint8_t* m_end;
+        uint64_t m_bits = 0;
+        unsigned m_count = 0;
+        unsigned m_padding = 0;
+    };
+
+    template <int TableBits>
+    class Huffman {
+    public:
+        bool build(const uint8_t* lengths, int count) {
+            std::memset(m_counts, 0, sizeof(m_counts));
+            std::memset(m_fast, 0, sizeof(m_fast));
+            for (int i = 0; i < count; i++) {
+                m_counts[lengths[i]]++;
+            }
+            m_counts[0] = 0;
+
+            int left = 1;
+            for (int len = 1; len <= MAX_BITS; len++) {
+                left = (left << 1) - m_counts[len];
+                if (left < 0) return false;
+            }
+
+            uint16_t offsets[MAX_BITS + 2] = {};
+            for (int len = 1; len <= MAX_BITS; len++) {
+                offsets[len + 1] = offsets[len] + m_counts[len];
+            }
+            for (int i = 0; i < count; i++) {
+                if (lengths[i]) m_symbols[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+            }
+
+            // Codes are stored MSB-first in an LSB-first stream, so the table is
+            // indexed by the bit-reversed code
+            int code = 0;
+            int index = 0;
+            for (int len = 1; len <= TableBits; len++) {
+                for (int i = 0; i < m_counts[len]; i++, code++, index++) {
+                    int reversed = 0;
+                    for (int bit = 0; bit < len; bit++) {
+                        reversed |= ((code >> bit) & 1) << (len - 1 - bit);
+                    }
+                    auto entry = static_cast<uint16_t>(m_symbols[index] << 4 | len);
+                    for (int slot = reversed; slot < (1 << TableBits); slot += 1 << len) {
+                        m_fast[slot] = entry;
+                    }
+                }
+                code <<= 1;
+            }
+            return true;
+        }
+
+        // Expects the reader to hold at least MAX_BITS bits. Returns -1 for codes
+        // that don't exist.
+        int decode(BitReader& reader) const {
+            auto bits = reader.peek();
+            if (auto entry = m_fast[bits & ((1 << TableBits) - 1)]) {
+                reader.consume(entry & 15);
+                return entry >> 4;
+            }
+
+            int code = 0;
+            int first = 0;
+            int index = 0;
+            for (int len = 1; len <= MAX_BITS; len++) {
+                code |= static_cast<int>((bits >> (len - 1)) & 1);
+                int count = m_counts[len];
+                if (code - first < count) {
+                    reader.consume(len);
+                    return m_symbols[index + code - first];
+                }
+                index += count;
+                first = (first + count) << 1;
+                code <<= 1;
+            }
+            return -1;
+        }
+
+    private:
+        // symbol << 4 | code length, or 0 for codes longer than TableBits
+        uint16_t m_fast[1 << TableBits];
+        uint16_t m_counts[MAX_BITS + 1];
+        uint16_t m_symbols[288];
+    };
+
+    using LitLenTable = Huffman<LITLEN_TABLE_BITS>;
+    using DistTable = Huffman<DIST_TABLE_BITS>;
+
+    struct FixedTables {
+        LitLenTable litlen;
+        DistTable dist;
+
+        FixedTables() {
+            uint8_t lengths[288];
+            std::memset(lengths, 8, 144);
+            std::memset(lengths + 144, 9, 112);
+            std::memset(lengths + 256, 7, 24);
+            std::memset(lengths + 280, 8, 8);
+            litlen.build(lengths, 288);
+
+            std::memset(lengths, 5, 30);
+            dist.build(lengths, 30);
+        }
+    };
+
+    bool readDynamicTables(BitReader& reader, LitLenTable& litlen, DistTable& dist) {
+        reader.refill();
+        int litlenCount = static_cast<int>(reader.get(5)) + 257;
+        int distCount = static_cast<int>(reader.get(5)) + 1;
+        int codelenCount = static_cast<int>(reader.get(4)) + 4;
+        if (litlenCount > 286 || distCount > 30) return false;
+
+        uint8_t codelenLengths[19] = {};
+        for (int i = 0; i < codelenCount; i++) {
+            // 19 lengths of 3 bits is more than one refill holds
+            reader.refill();
+            codelenLengths[CODELEN_ORDER[i]] = static_cast<uint8_t>(reader.get(3));
+        }
+        Huffman<CODELEN_TABLE_BITS> codelens;
+        if (!codelens.build(codelenLengths, 19)) return false;
+
+        uint8_t lengths[286 + 30] = {};
+        int total = litlenCount + distCount;
+        for (int i = 0; i < total;) {
+            reader.refill();
+            int symbol = codelens.decode(reader);
+            if (symbol < 0) return false;
+
+            if (symbol < 16) {
+                lengths[i++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+
+            uint8_t value = 0;
+            int repeat;
+            if (symbol == 16) {
+                if (i == 0) return false;
+                value = lengths[i - 1];
+                repeat = 3 + static_cast<int>(reader.get(2));
+            } else if (symbol == 17) {
+                repeat = 3 + static_cast<int>(reader.get(3));
+            } else {
+                repeat = 11 + static_cast<int>(reader.get(7));
+            }
+            if (i + repeat > total) return false;
+            std::memset(lengths + i, value, repeat);
+            i += repeat;
+        }
+
+        if (lengths[256] == 0) return false;
+        return litlen.build(lengths, litlenCount) && dist.build(lengths + litlenCount, distCount);
+    }
+
+    bool inflateBlock(BitReader& reader, const LitLenTable& litlen, const DistTable& dist, uint8_t* begin, uint8_t*& out, uint8_t* end) {
+        while (true) {
+            reader.refill();
+            int symbol = litlen.decode(reader);
+            if (symbol < 0) return false;
+
+            if (symbol < 256) {
+                if (out == end) return false;
+                *out++ = static_cast<uint8_t>(symbol);
+                continue;
+            }
+            if (symbol == 256) return !reader.overrun();
+
+            symbol -= 257;
+            if (symbol >= 29) return false;
+            size_t length = LENGTH_BASE[symbol] + reader.get(LENGTH_EXTRA[symbol]);
+
+            int distSymbol = dist.decode(reader);
+            if (distSymbol < 0 || distSymbol >= 30) return false;
+            size_t distance = DIST_BASE[distSymbol] + reader.get(DIST_EXTRA[distSymbol]);
+
+            if (distance > static_cast<size_t>(out - begin) || length > static_cast<size_t>(end - out)) return false;
+
+            const uint8_t* from = out - distance;
+            if (distance >= 8 && static_cast<size_t>(end - out) >= length + 8) {
+                // Whole words; a distance of 8 or more never reads bytes this copy writes
+                for (size_t i = 0; i < length; i += 8) {
+                    std::memcpy(out + i, from + i, 8);
+                }
+            } else if (distance == 1) {
+                std::memset(out, *from, length);
+            } else {
+                for (size_t i = 0; i < length; i++) {
+                    out[i] = from[i];
+                }
+            }
+            out += length;
+        }
+    }
+}
+
+bool inflateZlib(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize) {
+    if (srcSize < 2) return false;
+    unsigned cmf = src[0];
+    unsigned flg = src[1];
+    if ((cmf & 15) != 8 || (cmf >> 4) > 7 || (cmf * 256 + flg) % 31 != 0 || (flg & 32)) return false;
+
+    static const FixedTables fixed;
+    LitLenTable litlen;
+    DistTable dist;
+
+    BitReader reader(src + 2, srcSize - 2);
+    uint8_t* out = dst;
+    uint8_t* end = dst + dstSize;
+
+    bool last = false;
+    while (!last) {
+        reader.refill();
+        last = reader.get(1);
+        auto type = reader.get(2);
+
+        if (type == 0) {
+            reader.alignToByte();
+            auto length = reader.get(16);
+            auto inverse = reader.get(16);
+            if ((length ^ 0xffff) != inverse || length > static_cast<size_t>(end - out)) return false;
+            if (!reader.copyBytes(out, length)) return false;
+            out += length;
+        } else if (type == 1) {
+            if (!inflateBlock(reader, fixed.litlen, fixed.dist, dst, out, end)) return false;
+        } else if (type == 2) {
+            if (!readDynamicTables(reader, litlen, dist)) return false;
+            if (!inflateBlock(reader, litlen, dist, dst, out, end)) return false;
+        } else {
+            return false;
+        }
+        if (reader.overrun()) return false;
+    }
+    return out == end;
+}
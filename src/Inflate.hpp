@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Decompresses a zlib stream into `dst`, which has room for exactly
+// `dstSize` bytes. Made for PNG image data, where the decompressed size is
+// known up front. Returns false on corrupt input or if the output would not
+// fill `dst` exactly. The Adler-32 trailer is not checked.
+bool inflateZlib(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
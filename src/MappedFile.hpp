@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+// Read-only memory mapping of a whole file. The mapping lives as long as the
+// object, so hand out shared_ptrs when views into it outlive the caller.
+class MappedFile {
+public:
+    static std::shared_ptr<MappedFile> open(const std::filesystem::path& path);
+
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    MappedFile() = default;
+
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+};
@@ -0,0 +1,207 @@
+#include "MemeManifest.hpp"
+#include "AssetScan.hpp"
+#include "ImageAtlas.hpp"
+#include "TextureCache.hpp"
+#include "Trace.hpp"
+#include <Geode/Geode.hpp>
+#include <Geode/utils/file.hpp>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+using namespace geode::prelude;
+
+namespace {
+    int64_t mtimeOf(const std::filesystem::path& path) {
+        std::error_code ec;
+        auto mtime = std::filesystem::last_write_time(path, ec);
+        return ec ? 0 : static_cast<int64_t>(mtime.time_since_epoch().count());
+    }
+
+    const char* extString(MemeExt ext) {
+        switch (ext) {
+            case MemeExt::Png: return ".png";
+            case MemeExt::Ogg: return ".ogg";
+            case MemeExt::Mp3: return ".mp3";
+            case MemeExt::Gif: return ".gif";
+            default: return "";
+        }
+    }
+
+    void describeFile(const std::filesystem::path& path, uint64_t& size, int64_t& mtime, uint64_t& hash) {
+        std::error_code ec;
+        size = std::filesystem::file_size(path, ec);
+        if (ec) size = 0;
+        mtime = mtimeOf(path);
+
+        auto data = geode::utils::file::readBinary(path);
+        hash = data.isOk() ? TextureCache::hashContents(data.unwrap().data(), data.unwrap().size()) : 0;
+    }
+}
+
+std::string_view MemeTable::stem(size_t index) const {
+    auto& e = m_entries[index];
+    return std::string_view(m_strings + e.stemOffset, e.stemLength);
+}
+
+MemeAsset MemeTable::asset(size_t index) const {
+    auto& e = m_entries[index];
+    std::string name(stem(index));
+    return MemeAsset {
+        m_folder / (name + extString(e.imageExt)),
+        e.soundExt == MemeExt::None ? std::filesystem::path() : m_folder / (name + extString(e.soundExt)),
+    };
+}
+
+MemeManifest& MemeManifest::get() {
+    static MemeManifest instance;
+    return instance;
+}
+
+std::shared_ptr<const MemeTable> MemeManifest::snapshot() const {
+    std::lock_guard lock(m_mutex);
+    return m_table;
+}
+
+void MemeManifest::load(const std::filesystem::path& memesFolder, const std::filesystem::path& manifestPath) {
+    if (auto table = open(memesFolder, manifestPath)) {
+        log::info("Loaded meme manifest with {} entries", table->size());
+        {
+            std::lock_guard lock(m_mutex);
+            m_table = std::move(table);
+        }
+        Loader::get()->queueInMainThread([] { ImageAtlas::get()->refresh(); });
+        return;
+    }
+
+    std::thread([this, memesFolder, manifestPath] {
+        Trace::setThreadName("meme-manifest");
+        if (!build(memesFolder, manifestPath)) return;
+
+        auto table = open(memesFolder, manifestPath);
+        if (!table) {
+            log::error("Failed to map freshly built meme manifest: {}", manifestPath.string());
+            return;
+        }
+        log::info("Built meme manifest with {} entries", table->size());
+        {
+            std::lock_guard lock(m_mutex);
+            m_table = std::move(table);
+        }
+        Loader::get()->queueInMainThread([] { ImageAtlas::get()->refresh(); });
+    }).detach();
+}
+
+std::shared_ptr<MemeTable> MemeManifest::open(
+    const std::filesystem::path& memesFolder, const std::filesystem::path& manifestPath
+) {
+    auto file = MappedFile::open(manifestPath);
+    if (!file || file->size() < sizeof(MemeManifestHeader)) return nullptr;
+
+    auto* header = reinterpret_cast<const MemeManifestHeader*>(file->data());
+    if (std::memcmp(header->magic, "CDIM", 4) != 0 || header->version != VERSION) return nullptr;
+
+    size_t expected = sizeof(MemeManifestHeader)
+        + static_cast<size_t>(header->entryCount) * sizeof(MemeManifestEntry)
+        + header->stringBytes;
+    if (file->size() != expected) return nullptr;
+
+    // Anything added, removed or replaced in the folder bumps its mtime
+    if (header->folderMtime != mtimeOf(memesFolder)) return nullptr;
+
+    auto table = std::make_shared<MemeTable>();
+    table->m_header = header;
+    table->m_entries = reinterpret_cast<const MemeManifestEntry*>(file->data() + sizeof(MemeManifestHeader));
+    table->m_strings = reinterpret_cast<const char*>(table->m_entries + header->entryCount);
+    table->m_folder = memesFolder;
+
+    for (size_t i = 0; i < table->size(); i++) {
+        auto& e = table->m_entries[i];
+        if (static_cast<uint64_t>(e.stemOffset) + e.stemLength > header->stringBytes) return nullptr;
+    }
+
+    table->m_file = std::move(file);
+    return table;
+}
+
+bool MemeManifest::build(const std::filesystem::path& memesFolder, const std::filesystem::path& manifestPath) {
+    if (!std::filesystem::exists(memesFolder)) {
+        log::error("Memes folder does not exist: {}", memesFolder.string());
+        return false;
+    }
+
+    ScopedTrace trace(TracePhase::Scan);
+
+    // Read the folder mtime first so a change during the scan invalidates the result
+    int64_t folderMtime = mtimeOf(memesFolder);
+
+    AssetSlots slots;
+    try {
+        scanAssetFolder(memesFolder, slots);
+    } catch (const std::exception& e) {
+        log::error("Error reading memes folder: {}", e.what());
+        return false;
+    }
+
+    std::vector<MemeManifestEntry> entries;
+    std::string strings;
+    std::string lastStem;
+
+    for (const auto& meme : pairMemes(memesFolder, slots)) {
+        // Entries keep their extensions as a MemeExt, which only spells them in
+        // lower case
+        auto imageExt = meme.imagePath.extension();
+        auto soundExt = meme.soundPath.extension();
+        if (imageExt != ".png" && imageExt != ".gif") continue;
+        if (soundExt != ".mp3" && soundExt != ".ogg") continue;
+
+        // Both sounds of a stem come out next to each other and share its string
+        auto stem = meme.imagePath.stem().string();
+        if (entries.empty() || stem != lastStem) {
+            lastStem = stem;
+            strings += stem;
+        }
+
+        MemeManifestEntry e {};
+        e.stemOffset = static_cast<uint32_t>(strings.size() - stem.size());
+        e.stemLength = static_cast<uint32_t>(stem.size());
+        e.imageExt = imageExt == ".png" ? MemeExt::Png : MemeExt::Gif;
+        e.soundExt = soundExt == ".mp3" ? MemeExt::Mp3 : MemeExt::Ogg;
+        describeFile(meme.imagePath, e.imageSize, e.imageMtime, e.imageHash);
+        describeFile(meme.soundPath, e.soundSize, e.soundMtime, e.soundHash);
+        entries.push_back(e);
+    }
+
+    MemeManifestHeader header {};
+    std::memcpy(header.magic, "CDIM", 4);
+    header.version = VERSION;
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.stringBytes = static_cast<uint32_t>(strings.size());
+    header.folderMtime = folderMtime;
+
+    auto tempPath = manifestPath;
+    tempPath += ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(MemeManifestEntry));
+        out.write(strings.data(), strings.size());
+        if (!out) {
+            log::error("Failed to write meme manifest: {}", tempPath.string());
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, manifestPath, ec);
+    if (ec) {
+        log::error("Failed to replace meme manifest: {}", ec.message());
+        return false;
+    }
+    return true;
+}
+
+$on_mod(Loaded) {
+    auto* mod = Mod::get();
+    MemeManifest::get().load(mod->getResourcesDir() / "memes", mod->getSaveDir() / "memes.cdim");
+}
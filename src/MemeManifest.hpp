@@ -0,0 +1,97 @@
+#pragma once
+
+#include "MappedFile.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string_view>
+
+struct MemeAsset {
+    std::filesystem::path imagePath;
+    std::filesystem::path soundPath;
+};
+
+// On-disk layout of memes.cdim. Everything is fixed-size and little-endian so
+// the file can be used straight from a read-only mapping.
+struct MemeManifestHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t stringBytes;
+    // mtime of the memes folder when the manifest was written
+    int64_t folderMtime;
+};
+
+enum class MemeExt : uint8_t {
+    None = 0,
+    Png,
+    Ogg,
+    Mp3,
+    Gif,
+};
+
+struct MemeManifestEntry {
+    // Stem shared by the image and its sound, interned in the string table
+    uint32_t stemOffset;
+    uint32_t stemLength;
+    MemeExt imageExt;
+    MemeExt soundExt;
+    uint8_t padding[6];
+    uint64_t imageSize;
+    int64_t imageMtime;
+    uint64_t imageHash;
+    uint64_t soundSize;
+    int64_t soundMtime;
+    uint64_t soundHash;
+};
+
+static_assert(sizeof(MemeManifestHeader) == 24);
+static_assert(sizeof(MemeManifestEntry) == 64);
+
+// A validated, mapped manifest. Header, entries and string table all point
+// into the mapping.
+class MemeTable {
+public:
+    size_t size() const { return m_header ? m_header->entryCount : 0; }
+    bool empty() const { return size() == 0; }
+
+    const MemeManifestEntry& entry(size_t index) const { return m_entries[index]; }
+    std::string_view stem(size_t index) const;
+    MemeAsset asset(size_t index) const;
+
+    const std::filesystem::path& folder() const { return m_folder; }
+
+private:
+    friend class MemeManifest;
+
+    std::shared_ptr<MappedFile> m_file;
+    std::filesystem::path m_folder;
+    const MemeManifestHeader* m_header = nullptr;
+    const MemeManifestEntry* m_entries = nullptr;
+    const char* m_strings = nullptr;
+};
+
+// Pairs the images and sounds in resources/memes through a manifest kept in the
+// save dir. A valid manifest is mapped at load without listing the folder; a
+// missing or stale one is rebuilt on a background thread.
+class MemeManifest {
+public:
+    static constexpr uint32_t VERSION = 2;
+
+    static MemeManifest& get();
+
+    void load(const std::filesystem::path& memesFolder, const std::filesystem::path& manifestPath);
+
+    // nullptr until a manifest has been mapped
+    std::shared_ptr<const MemeTable> snapshot() const;
+
+private:
+    static std::shared_ptr<MemeTable> open(
+        const std::filesystem::path& memesFolder, const std::filesystem::path& manifestPath
+    );
+    static bool build(const std::filesystem::path& memesFolder, const std::filesystem::path& manifestPath);
+
+    mutable std::mutex m_mutex;
+    std::shared_ptr<const MemeTable> m_table;
+};
@@ -0,0 +1,130 @@
+#include "PerfHud.hpp"
+#include "AsyncLoader.hpp"
+#include "DeathBudget.hpp"
+#include "SoundBank.hpp"
+#include "TextureCache.hpp"
+#include "ThumbnailCache.hpp"
+#include "Trace.hpp"
+#include <iterator>
+
+namespace {
+    int countNodes(CCNode* node) {
+        int count = 1;
+        auto* children = node->getChildren();
+        for (unsigned i = 0; children && i < children->count(); i++) {
+            count += countNodes(static_cast<CCNode*>(children->objectAtIndex(i)));
+        }
+        return count;
+    }
+
+    double hitRate(uint64_t hits, uint64_t misses) {
+        return hits + misses ? 100.0 * static_cast<double>(hits) / static_cast<double>(hits + misses) : 0.0;
+    }
+
+    double megabytes(size_t bytes) {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+
+    double milliseconds(uint64_t ns) {
+        return static_cast<double>(ns) / 1e6;
+    }
+}
+
+PerfHud* PerfHud::create() {
+    auto ret = new PerfHud();
+    if (ret && ret->init()) {
+        ret->autorelease();
+        return ret;
+    }
+    CC_SAFE_DELETE(ret);
+    return nullptr;
+}
+
+bool PerfHud::init() {
+    if (!CCNode::init()) return false;
+    this->setID("perf-hud");
+
+    m_bg = CCLayerColor::create(ccc4(0, 0, 0, 150));
+    this->addChild(m_bg);
+
+    m_label = CCLabelBMFont::create("", "chatFont.fnt");
+    m_label->setAnchorPoint(ccp(0, 1));
+    m_label->setScale(0.5f);
+    this->addChild(m_label, 1);
+    return true;
+}
+
+void PerfHud::onEnter() {
+    CCNode::onEnter();
+    Trace::setWatching(true);
+    this->schedule(schedule_selector(PerfHud::refresh), REFRESH_SECONDS);
+    refresh(0);
+}
+
+void PerfHud::onExit() {
+    this->unschedule(schedule_selector(PerfHud::refresh));
+    Trace::setWatching(false);
+    CCNode::onExit();
+}
+
+void PerfHud::refresh(float) {
+    m_text.clear();
+    auto out = std::back_inserter(m_text);
+
+    auto& textures = TextureCache::get();
+    fmt::format_to(
+        out, "Images: {:.0f}% hit ({} of {}), {:.1f} MB in textures\n",
+        hitRate(textures.getHits(), textures.getMisses()), textures.getHits(),
+        textures.getHits() + textures.getMisses(), megabytes(textures.getResidentBytes() + textures.getReservedBytes())
+    );
+    auto* sounds = SoundBank::get();
+    fmt::format_to(
+        out, "Sounds: {:.0f}% hit ({} of {}), {:.1f} MB in FMOD, {} playing\n",
+        hitRate(sounds->getHits(), sounds->getMisses()), sounds->getHits(),
+        sounds->getHits() + sounds->getMisses(), megabytes(sounds->getResidentBytes()), sounds->getVoiceCount()
+    );
+
+    auto& budget = DeathBudget::stats();
+    fmt::format_to(
+        out, "Death: last {:.2f} ms, worst {:.2f} ms, {} of {} over budget\n",
+        budget.lastMs, budget.worstMs, budget.overBudget, budget.deaths
+    );
+    for (size_t i = 0; i < static_cast<size_t>(TracePhase::Count); i++) {
+        auto phase = static_cast<TracePhase>(i);
+        auto latency = Trace::latency(phase);
+        if (!latency.worst) continue;
+        fmt::format_to(
+            out, "    {}: last {:.2f} ms, worst {:.2f} ms\n",
+            tracePhaseName(phase), milliseconds(latency.last), milliseconds(latency.worst)
+        );
+    }
+
+    fmt::format_to(
+        out, "Pending: {} loads, {} thumbnails\n", AsyncLoader::get()->pending(), ThumbnailCache::get().pending()
+    );
+
+    // Counted from the layer itself, so a node that is never removed shows up
+    int pipNodes = 0;
+    int deathNodes = 0;
+    if (auto* layer = this->getParent()) {
+        auto* children = layer->getChildren();
+        for (unsigned i = 0; children && i < children->count(); i++) {
+            auto* child = static_cast<CCNode*>(children->objectAtIndex(i));
+            const auto& id = child->getID();
+            if (id == "pip-overlay") {
+                pipNodes += countNodes(child);
+            } else if (id == "death-image" || id == "black-overlay" || id == "death-image-placeholder") {
+                deathNodes += countNodes(child);
+            }
+        }
+    }
+    fmt::format_to(out, "Nodes: {} PiP, {} death", pipNodes, deathNodes);
+
+    m_label->setString(m_text.c_str());
+
+    auto winSize = CCDirector::sharedDirector()->getWinSize();
+    auto size = m_label->getScaledContentSize();
+    m_label->setPosition(ccp(6, winSize.height - 6));
+    m_bg->setContentSize({ size.width + 8, size.height + 8 });
+    m_bg->setPosition(ccp(2, winSize.height - size.height - 10));
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <Geode/Geode.hpp>
+#include <string>
+
+using namespace geode::prelude;
+
+// Debug overlay for the PlayLayer it is added to (F3 with `perf-hud` on):
+// cache hit rates, resident texture and sound bytes, death latency by phase,
+// pending loads and how many PiP and death nodes the layer holds. All of it
+// is one bitmap-font label, so it draws in one batch, and it is rewritten
+// REFRESH_SECONDS apart rather than every frame.
+class PerfHud : public CCNode {
+public:
+    static constexpr float REFRESH_SECONDS = 0.25f;
+
+    static PerfHud* create();
+
+    void onEnter() override;
+    void onExit() override;
+
+protected:
+    bool init() override;
+
+private:
+    void refresh(float dt);
+
+    CCLayerColor* m_bg = nullptr;
+    CCLabelBMFont* m_label = nullptr;
+    // Reused between refreshes
+    std::string m_text;
+};
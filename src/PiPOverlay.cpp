@@ -0,0 +1,159 @@
+#include "PiPOverlay.hpp"
+#include "AsyncLoader.hpp"
+#include "ImageAnimation.hpp"
+#include "PiPPositionWriter.hpp"
+#include <cmath>
+
+PiPOverlay* PiPOverlay::create() {
+    auto ret = new PiPOverlay();
+    if (ret && ret->init()) {
+        ret->autorelease();
+        return ret;
+    }
+    CC_SAFE_DELETE(ret);
+    return nullptr;
+}
+
+bool PiPOverlay::init() {
+    if (!CCNode::init()) return false;
+
+    this->setID("pip-overlay");
+    this->setAnchorPoint(ccp(0.5f, 0.5f));
+    this->setVisible(false);
+
+    m_bg = CCLayerColor::create(ccc4(0, 0, 0, 100));
+    this->addChild(m_bg);
+
+    m_sprite = CCSprite::create();
+    m_sprite->setAnchorPoint(ccp(0.5f, 0.5f));
+    this->addChild(m_sprite);
+
+    this->scheduleUpdate();
+    return true;
+}
+
+void PiPOverlay::update(float) {
+    auto settings = Settings::snapshot();
+    if (settings != m_applied) {
+        m_applied = settings;
+        apply(*settings);
+    }
+}
+
+void PiPOverlay::visit() {
+    CCNode::visit();
+    // Dragging happens under the O preview, which pauses the director and
+    // with it the writer's own schedule; drawing goes on at 4 fps
+    PiPPositionWriter::get()->poll();
+}
+
+void PiPOverlay::apply(const Settings& settings) {
+
+    if (!settings.enabled || !settings.pipMode) {
+        this->setVisible(false);
+        return;
+    }
+
+    std::filesystem::path imagePath;
+    if (settings.pipUseCustomImage) {
+        imagePath = settings.pipImagePath;
+    }
+    if (imagePath.empty()) {
+        imagePath = settings.defaultPiPImagePath;
+    }
+
+    ImageTarget target;
+    target.width = static_cast<uint32_t>(std::ceil(
+        CCDirector::sharedDirector()->getWinSizeInPixels().width * settings.pipSize / 100.0f * settings.pipSizeMultiplier
+    ));
+
+    if (imagePath != m_imagePath || target != m_target) {
+        setImage(imagePath, target);
+    } else {
+        layout(settings);
+    }
+}
+
+void PiPOverlay::setImage(const std::filesystem::path& path, const ImageTarget& target) {
+    m_imagePath = path;
+    m_target = target;
+    int serial = ++m_loadSerial;
+
+    Ref<PiPOverlay> self = this;
+    auto handle = AsyncLoader::get()->load(path, target);
+    handle->then([this, self, serial, handle](CCTexture2D* texture) {
+        // A newer image was picked while this one was loading
+        if (serial != m_loadSerial) return;
+
+        if (!texture) {
+            this->setVisible(false);
+            return;
+        }
+
+        // Animations loop for as long as the overlay shows the image
+        setSpriteImage(m_sprite, *handle, 0);
+        layout(*m_applied);
+    });
+}
+
+void PiPOverlay::layout(const Settings& settings) {
+    auto* texture = m_sprite->getTexture();
+    if (!texture) return;
+
+    CCSize winSize = CCDirector::sharedDirector()->getWinSize();
+    CCSize originalSize = m_sprite->getContentSize();
+    float pipSize = settings.pipSize / 100.0f;
+    float scale = (winSize.width * pipSize * settings.pipSizeMultiplier) / originalSize.width;
+    CCSize scaledSize = CCSizeMake(originalSize.width * scale, originalSize.height * scale);
+
+    this->setContentSize(scaledSize);
+    m_bg->setContentSize(scaledSize);
+    m_sprite->setScale(scale);
+    m_sprite->setPosition(ccp(scaledSize.width / 2, scaledSize.height / 2));
+
+    float padding = static_cast<float>(settings.pipPadding);
+    float offsetX = static_cast<float>(settings.pipOffsetX);
+    float offsetY = static_cast<float>(settings.pipOffsetY);
+    CCPoint basePos;
+
+    if (settings.hasCustomPosition) {
+        basePos = ccp(settings.pipPositionX * winSize.width, settings.pipPositionY * winSize.height);
+    } else {
+        switch (settings.pipPosition) {
+            case 0:
+                basePos = ccp(winSize.width - scaledSize.width/2 - padding + offsetX,
+                             winSize.height - scaledSize.height/2 - padding - offsetY);
+                break;
+            case 1:
+                basePos = ccp(scaledSize.width/2 + padding + offsetX,
+                             winSize.height - scaledSize.height/2 - padding - offsetY);
+                break;
+            case 2:
+                basePos = ccp(winSize.width - scaledSize.width/2 - padding + offsetX,
+                             scaledSize.height/2 + padding + offsetY);
+                break;
+            case 3:
+                basePos = ccp(scaledSize.width/2 + padding + offsetX,
+                             scaledSize.height/2 + padding + offsetY);
+                break;
+        }
+    }
+
+    this->setPosition(clampPosition(basePos));
+    this->setVisible(true);
+}
+
+CCPoint PiPOverlay::clampPosition(CCPoint position) const {
+    CCSize winSize = CCDirector::sharedDirector()->getWinSize();
+    CCSize size = this->getContentSize();
+    float padding = static_cast<float>(Settings::get().pipPadding);
+
+    float halfWidth = size.width / 2;
+    float halfHeight = size.height / 2;
+
+    position.x = std::max(halfWidth + padding,
+                 std::min(position.x, winSize.width - halfWidth - padding));
+    position.y = std::max(halfHeight + padding,
+                 std::min(position.y, winSize.height - halfHeight - padding));
+    return position;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "ImageDecoder.hpp"
+#include "Settings.hpp"
+#include <Geode/Geode.hpp>
+#include <filesystem>
+
+using namespace geode::prelude;
+
+// The picture-in-picture window, built once per PlayLayer. The backdrop and
+// image are children of this node, so moving it moves both. It relayouts
+// itself only when a new settings snapshot is published, which keeps level
+// resets from touching it at all. The texture is shrunk to the PiP box.
+class PiPOverlay : public CCNode {
+public:
+    static PiPOverlay* create();
+
+    // Keeps a PiP position inside the screen, minus the configured padding
+    CCPoint clampPosition(CCPoint position) const;
+
+    void update(float dt) override;
+    void visit() override;
+
+protected:
+    bool init() override;
+
+private:
+    void apply(const Settings& settings);
+    void setImage(const std::filesystem::path& path, const ImageTarget& target);
+    void layout(const Settings& settings);
+
+    CCLayerColor* m_bg = nullptr;
+    CCSprite* m_sprite = nullptr;
+    std::filesystem::path m_imagePath;
+    ImageTarget m_target;
+    // Held so its address can't be reused by a newer snapshot
+    std::shared_ptr<const Settings> m_applied;
+    int m_loadSerial = 0;
+};
@@ -0,0 +1,42 @@
+#include "PiPPositionWriter.hpp"
+#include "Settings.hpp"
+
+PiPPositionWriter* PiPPositionWriter::get() {
+    // Never released: the poll schedule points at it for the whole session
+    static auto* instance = new PiPPositionWriter();
+    return instance;
+}
+
+PiPPositionWriter::PiPPositionWriter() {
+    CCDirector::sharedDirector()->getScheduler()->scheduleSelector(
+        schedule_selector(PiPPositionWriter::onPoll), this, POLL_SECONDS, kCCRepeatForever, 0.0f, false
+    );
+}
+
+void PiPPositionWriter::stage(float normalizedX, float normalizedY) {
+    m_pending = Position { normalizedX, normalizedY };
+    m_stagedAt = std::chrono::steady_clock::now();
+}
+
+void PiPPositionWriter::poll() {
+    if (!m_pending) return;
+    auto quiet = std::chrono::duration<float>(std::chrono::steady_clock::now() - m_stagedAt);
+    if (quiet.count() >= QUIET_SECONDS) flush();
+}
+
+void PiPPositionWriter::flush() {
+    if (!m_pending) return;
+
+    auto position = *m_pending;
+    m_pending.reset();
+
+    Settings::Batch batch;
+    auto* mod = Mod::get();
+    mod->setSettingValue<double>("pip-position-x", position.x);
+    mod->setSettingValue<double>("pip-position-y", position.y);
+    mod->setSettingValue<bool>("has-custom-position", true);
+}
+
+void PiPPositionWriter::onPoll(float) {
+    poll();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Geode/Geode.hpp>
+#include <chrono>
+#include <optional>
+
+using namespace geode::prelude;
+
+// Write-behind for the dragged PiP position. Dragging only stages the latest
+// normalized position in memory; it is written to the mod settings once, when
+// the drag ends or after the position has been still for QUIET_SECONDS.
+// Staging only stamps the time: one schedule that never changes checks it.
+class PiPPositionWriter : public CCObject {
+public:
+    static constexpr float QUIET_SECONDS = 0.5f;
+    static constexpr float POLL_SECONDS = 0.1f;
+
+    static PiPPositionWriter* get();
+
+    void stage(float normalizedX, float normalizedY);
+    // Writes the staged position, if any, as one batch.
+    void flush();
+    // Flushes once the staged position has been still for QUIET_SECONDS. The
+    // scheduler stops while the director is paused, as it is for the O
+    // preview, so the preview calls this itself as it draws.
+    void poll();
+
+private:
+    struct Position {
+        float x;
+        float y;
+    };
+
+    PiPPositionWriter();
+    void onPoll(float dt);
+
+    std::optional<Position> m_pending;
+    std::chrono::steady_clock::time_point m_stagedAt;
+};
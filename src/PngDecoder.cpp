@@ -0,0 +1,477 @@
+#include "PngDecoder.hpp"
+#include "Inflate.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define CDI_PNG_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define CDI_PNG_NEON
+#endif
+
+namespace {
+    enum ColorType : uint8_t {
+        Grey = 0,
+        RGB = 2,
+        Palette = 3,
+        GreyAlpha = 4,
+        RGBA = 6,
+    };
+
+    constexpr uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    constexpr uint32_t MAX_DIMENSION = 1 << 15;
+
+    uint32_t readU32(const uint8_t* p) {
+        return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | uint32_t(p[3]);
+    }
+
+    // Same rounding as CCImage, so both decoders produce identical pixels
+    inline uint8_t premultiply(uint8_t value, uint8_t alpha) {
+        return static_cast<uint8_t>((value * (alpha + 1u)) >> 8);
+    }
+
+    uint8_t paeth(uint8_t a, uint8_t b, uint8_t c) {
+        int pa = b - c;
+        int pb = a - c;
+        int pc = pa + pb;
+        pa = pa < 0 ? -pa : pa;
+        pb = pb < 0 ? -pb : pb;
+        pc = pc < 0 ? -pc : pc;
+        if (pa <= pb && pa <= pc) return a;
+        return pb <= pc ? b : c;
+    }
+
+    // Built in a register: a 3-byte memcpy into a stack temporary stalls
+    // store forwarding on every pixel
+    template <unsigned Bpp>
+    inline uint32_t readPixel(const uint8_t* p) {
+        if constexpr (Bpp == 4) {
+            uint32_t value;
+            std::memcpy(&value, p, 4);
+            return value;
+        } else {
+            uint16_t low;
+            std::memcpy(&low, p, 2);
+            return low | uint32_t(p[2]) << 16;
+        }
+    }
+
+    template <unsigned Bpp>
+    inline void writePixel(uint8_t* p, uint32_t value) {
+        if constexpr (Bpp == 4) {
+            std::memcpy(p, &value, 4);
+        } else {
+            auto low = static_cast<uint16_t>(value);
+            std::memcpy(p, &low, 2);
+            p[2] = static_cast<uint8_t>(value >> 16);
+        }
+    }
+
+    void unfilterScalar(uint8_t filter, uint8_t* row, const uint8_t* prev, size_t length, unsigned bpp) {
+        switch (filter) {
+            case 1:
+                for (size_t i = bpp; i < length; i++) row[i] += row[i - bpp];
+                break;
+            case 2:
+                for (size_t i = 0; i < length; i++) row[i] += prev[i];
+                break;
+            case 3:
+                for (size_t i = 0; i < bpp; i++) row[i] += prev[i] >> 1;
+                for (size_t i = bpp; i < length; i++) row[i] += (row[i - bpp] + prev[i]) >> 1;
+                break;
+            case 4:
+                for (size_t i = 0; i < bpp; i++) row[i] += prev[i];
+                for (size_t i = bpp; i < length; i++) row[i] += paeth(row[i - bpp], prev[i], prev[i - bpp]);
+                break;
+        }
+    }
+
+#if defined(CDI_PNG_SSE2)
+    // One pixel of Bpp bytes in the low lanes of a register
+    template <unsigned Bpp>
+    inline __m128i loadPixel(const uint8_t* p) {
+        return _mm_cvtsi32_si128(static_cast<int32_t>(readPixel<Bpp>(p)));
+    }
+
+    template <unsigned Bpp>
+    inline void storePixel(uint8_t* p, __m128i pixel) {
+        writePixel<Bpp>(p, static_cast<uint32_t>(_mm_cvtsi128_si32(pixel)));
+    }
+
+    inline __m128i abs16(__m128i x) {
+        return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+    }
+
+    inline __m128i select(__m128i mask, __m128i yes, __m128i no) {
+        return _mm_or_si128(_mm_and_si128(mask, yes), _mm_andnot_si128(mask, no));
+    }
+
+    void unfilterUp(uint8_t* row, const uint8_t* prev, size_t length) {
+        size_t i = 0;
+        for (; i + 16 <= length; i += 16) {
+            auto sum = _mm_add_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i))
+            );
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), sum);
+        }
+        for (; i < length; i++) row[i] += prev[i];
+    }
+
+    template <unsigned Bpp>
+    void unfilterPixels(uint8_t filter, uint8_t* row, const uint8_t* prev, size_t length) {
+        auto zero = _mm_setzero_si128();
+        switch (filter) {
+            case 1: {
+                auto a = zero;
+                for (size_t i = 0; i < length; i += Bpp) {
+                    a = _mm_add_epi8(a, loadPixel<Bpp>(row + i));
+                    storePixel<Bpp>(row + i, a);
+                }
+                break;
+            }
+            case 3: {
+                auto a = zero;
+                auto one = _mm_set1_epi8(1);
+                for (size_t i = 0; i < length; i += Bpp) {
+                    auto b = loadPixel<Bpp>(prev + i);
+                    // pavgb rounds up, PNG rounds down
+                    auto average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+                    a = _mm_add_epi8(loadPixel<Bpp>(row + i), average);
+                    storePixel<Bpp>(row + i, a);
+                }
+                break;
+            }
+            case 4: {
+                // a, b and c widened to 16 bits so the predictor math can't overflow
+                auto a = zero;
+                auto c = zero;
+                for (size_t i = 0; i < length; i += Bpp) {
+                    auto b = _mm_unpacklo_epi8(loadPixel<Bpp>(prev + i), zero);
+                    auto pa = _mm_sub_epi16(b, c);
+                    auto pb = _mm_sub_epi16(a, c);
+                    auto pc = abs16(_mm_add_epi16(pa, pb));
+                    pa = abs16(pa);
+                    pb = abs16(pb);
+
+                    auto smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+                    auto nearest = select(
+                        _mm_cmpeq_epi16(smallest, pa), a,
+                        select(_mm_cmpeq_epi16(smallest, pb), b, c)
+                    );
+
+                    auto x = _mm_add_epi8(loadPixel<Bpp>(row + i), _mm_packus_epi16(nearest, nearest));
+                    storePixel<Bpp>(row + i, x);
+                    a = _mm_unpacklo_epi8(x, zero);
+                    c = b;
+                }
+                break;
+            }
+        }
+    }
+
+    size_t premultiplyRGBA(const uint8_t* src, uint8_t* dst, size_t pixels) {
+        auto zero = _mm_setzero_si128();
+        auto one = _mm_set1_epi16(1);
+        auto alphaLanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+
+        auto half = [&](__m128i wide) {
+            auto alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(wide, 0xff), 0xff);
+            auto scaled = _mm_srli_epi16(_mm_mullo_epi16(wide, _mm_add_epi16(alpha, one)), 8);
+            return select(alphaLanes, wide, scaled);
+        };
+
+        size_t i = 0;
+        for (; i + 4 <= pixels; i += 4) {
+            auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+            auto lo = half(_mm_unpacklo_epi8(v, zero));
+            auto hi = half(_mm_unpackhi_epi8(v, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_packus_epi16(lo, hi));
+        }
+        return i;
+    }
+#elif defined(CDI_PNG_NEON)
+    template <unsigned Bpp>
+    inline uint8x8_t loadPixel(const uint8_t* p) {
+        return vreinterpret_u8_u32(vdup_n_u32(readPixel<Bpp>(p)));
+    }
+
+    template <unsigned Bpp>
+    inline void storePixel(uint8_t* p, uint8x8_t pixel) {
+        writePixel<Bpp>(p, vget_lane_u32(vreinterpret_u32_u8(pixel), 0));
+    }
+
+    void unfilterUp(uint8_t* row, const uint8_t* prev, size_t length) {
+        size_t i = 0;
+        for (; i + 16 <= length; i += 16) {
+            vst1q_u8(row + i, vaddq_u8(vld1q_u8(row + i), vld1q_u8(prev + i)));
+        }
+        for (; i < length; i++) row[i] += prev[i];
+    }
+
+    template <unsigned Bpp>
+    void unfilterPixels(uint8_t filter, uint8_t* row, const uint8_t* prev, size_t length) {
+        auto zero = vdup_n_u8(0);
+        switch (filter) {
+            case 1: {
+                auto a = zero;
+                for (size_t i = 0; i < length; i += Bpp) {
+                    a = vadd_u8(a, loadPixel<Bpp>(row + i));
+                    storePixel<Bpp>(row + i, a);
+                }
+                break;
+            }
+            case 3: {
+                auto a = zero;
+                for (size_t i = 0; i < length; i += Bpp) {
+                    a = vadd_u8(loadPixel<Bpp>(row + i), vhadd_u8(a, loadPixel<Bpp>(prev + i)));
+                    storePixel<Bpp>(row + i, a);
+                }
+                break;
+            }
+            case 4: {
+                auto a = zero;
+                auto c = zero;
+                for (size_t i = 0; i < length; i += Bpp) {
+                    auto b = loadPixel<Bpp>(prev + i);
+                    auto pa = vabdl_u8(b, c);
+                    auto pb = vabdl_u8(a, c);
+                    auto pc = vabdq_u16(vaddl_u8(a, b), vaddl_u8(c, c));
+
+                    auto useA = vmovn_u16(vandq_u16(vcleq_u16(pa, pb), vcleq_u16(pa, pc)));
+                    auto useB = vmovn_u16(vcleq_u16(pb, pc));
+                    auto nearest = vbsl_u8(useA, a, vbsl_u8(useB, b, c));
+
+                    a = vadd_u8(loadPixel<Bpp>(row + i), nearest);
+                    storePixel<Bpp>(row + i, a);
+                    c = b;
+                }
+                break;
+            }
+        }
+    }
+
+    size_t premultiplyRGBA(const uint8_t* src, uint8_t* dst, size_t pixels) {
+        size_t i = 0;
+        for (; i + 8 <= pixels; i += 8) {
+            auto v = vld4_u8(src + i * 4);
+            for (int channel = 0; channel < 3; channel++) {
+                v.val[channel] = vshrn_n_u16(vaddw_u8(vmull_u8(v.val[channel], v.val[3]), v.val[channel]), 8);
+            }
+            vst4_u8(dst + i * 4, v);
+        }
+        return i;
+    }
+#endif
+
+    void unfilterRow(uint8_t filter, uint8_t* row, const uint8_t* prev, size_t length, unsigned bpp) {
+#if defined(CDI_PNG_SSE2) || defined(CDI_PNG_NEON)
+        if (filter == 2) {
+            unfilterUp(row, prev, length);
+            return;
+        }
+        if (bpp == 4) {
+            unfilterPixels<4>(filter, row, prev, length);
+            return;
+        }
+        if (bpp == 3) {
+            unfilterPixels<3>(filter, row, prev, length);
+            return;
+        }
+#endif
+        unfilterScalar(filter, row, prev, length, bpp);
+    }
+
+    struct Header {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint8_t bitDepth = 0;
+        uint8_t colorType = 0;
+        uint8_t interlace = 0;
+    };
+
+    bool supported(const Header& header) {
+        if (header.interlace != 0) return false;
+        if (!header.width || !header.height || header.width > MAX_DIMENSION || header.height > MAX_DIMENSION) return false;
+        if (header.colorType == Palette) {
+            return header.bitDepth == 1 || header.bitDepth == 2 || header.bitDepth == 4 || header.bitDepth == 8;
+        }
+        return header.bitDepth == 8 && (
+            header.colorType == Grey || header.colorType == RGB ||
+            header.colorType == GreyAlpha || header.colorType == RGBA
+        );
+    }
+
+    unsigned channelCount(uint8_t colorType) {
+        switch (colorType) {
+            case RGB: return 3;
+            case GreyAlpha: return 2;
+            case RGBA: return 4;
+            default: return 1;
+        }
+    }
+
+    // Expands one unfiltered row into premultiplied RGBA
+    void convertRow(const Header& header, const uint8_t* src, uint8_t* dst, const uint32_t* palette) {
+        size_t width = header.width;
+        switch (header.colorType) {
+            case RGBA: {
+                size_t i = 0;
+#if defined(CDI_PNG_SSE2) || defined(CDI_PNG_NEON)
+                i = premultiplyRGBA(src, dst, width);
+#endif
+                for (; i < width; i++) {
+                    uint8_t alpha = src[i * 4 + 3];
+                    dst[i * 4 + 0] = premultiply(src[i * 4 + 0], alpha);
+                    dst[i * 4 + 1] = premultiply(src[i * 4 + 1], alpha);
+                    dst[i * 4 + 2] = premultiply(src[i * 4 + 2], alpha);
+                    dst[i * 4 + 3] = alpha;
+                }
+                break;
+            }
+            case RGB:
+                for (size_t i = 0; i < width; i++) {
+                    writePixel<4>(dst + i * 4, readPixel<3>(src + i * 3) | 0xff000000u);
+                }
+                break;
+            case Grey:
+                for (size_t i = 0; i < width; i++) {
+                    dst[i * 4 + 0] = dst[i * 4 + 1] = dst[i * 4 + 2] = src[i];
+                    dst[i * 4 + 3] = 255;
+                }
+                break;
+            case GreyAlpha:
+                for (size_t i = 0; i < width; i++) {
+                    uint8_t alpha = src[i * 2 + 1];
+                    dst[i * 4 + 0] = dst[i * 4 + 1] = dst[i * 4 + 2] = premultiply(src[i * 2], alpha);
+                    dst[i * 4 + 3] = alpha;
+                }
+                break;
+            case Palette: {
+                unsigned depth = header.bitDepth;
+                unsigned mask = (1u << depth) - 1;
+                for (size_t i = 0; i < width; i++) {
+                    size_t bit = i * depth;
+                    unsigned index = (src[bit >> 3] >> (8 - depth - (bit & 7))) & mask;
+                    std::memcpy(dst + i * 4, &palette[index], 4);
+                }
+                break;
+            }
+        }
+    }
+}
+
+std::optional<DecodedImage> decodePng(const uint8_t* data, size_t size) {
+    if (size < 8 || std::memcmp(data, SIGNATURE, 8) != 0) return std::nullopt;
+
+    Header header;
+    std::vector<std::pair<const uint8_t*, size_t>> idat;
+    size_t idatBytes = 0;
+    uint8_t paletteRGB[256 * 3] = {};
+    uint8_t paletteAlpha[256];
+    std::memset(paletteAlpha, 255, sizeof(paletteAlpha));
+    size_t paletteSize = 0;
+    bool sawHeader = false;
+
+    size_t pos = 8;
+    while (true) {
+        if (size - pos < 12) return std::nullopt;
+        uint32_t length = readU32(data + pos);
+        const uint8_t* type = data + pos + 4;
+        const uint8_t* body = data + pos + 8;
+        if (length > size - pos - 12) return std::nullopt;
+
+        if (std::memcmp(type, "IHDR", 4) == 0) {
+            if (length != 13) return std::nullopt;
+            header.width = readU32(body);
+            header.height = readU32(body + 4);
+            header.bitDepth = body[8];
+            header.colorType = body[9];
+            header.interlace = body[12];
+            if (body[10] != 0 || body[11] != 0 || !supported(header)) return std::nullopt;
+            sawHeader = true;
+        } else if (std::memcmp(type, "PLTE", 4) == 0) {
+            if (length % 3 != 0 || length > sizeof(paletteRGB)) return std::nullopt;
+            std::memcpy(paletteRGB, body, length);
+            paletteSize = length / 3;
+        } else if (std::memcmp(type, "tRNS", 4) == 0) {
+            // Colour-key transparency on non-palette images is rare; CCImage handles it
+            if (header.colorType != Palette || length > 256) return std::nullopt;
+            std::memcpy(paletteAlpha, body, length);
+        } else if (std::memcmp(type, "IDAT", 4) == 0) {
+            idat.emplace_back(body, length);
+            idatBytes += length;
+        } else if (std::memcmp(type, "IEND", 4) == 0) {
+            break;
+        } else if (!(type[0] & 0x20)) {
+            // Unknown critical chunk
+            return std::nullopt;
+        }
+        pos += 12 + size_t(length);
+    }
+    if (!sawHeader || idat.empty()) return std::nullopt;
+    if (header.colorType == Palette && paletteSize == 0) return std::nullopt;
+
+    unsigned channels = channelCount(header.colorType);
+    size_t rowBytes = (size_t(header.width) * channels * header.bitDepth + 7) / 8;
+    unsigned bpp = std::max(1u, channels * header.bitDepth / 8);
+    size_t stride = rowBytes + 1;
+
+    // IDAT chunks form one zlib stream; most encoders write a single chunk
+    std::vector<uint8_t> joined;
+    const uint8_t* stream = idat.front().first;
+    if (idat.size() > 1) {
+        joined.reserve(idatBytes);
+        for (auto& [chunk, length] : idat) {
+            joined.insert(joined.end(), chunk, chunk + length);
+        }
+        stream = joined.data();
+    }
+
+    std::vector<uint8_t> raw(stride * header.height);
+    if (!inflateZlib(stream, idatBytes, raw.data(), raw.size())) return std::nullopt;
+
+    uint32_t palette[256] = {};
+    for (size_t i = 0; i < 256; i++) {
+        uint8_t alpha = i < paletteSize ? paletteAlpha[i] : 255;
+        uint8_t rgba[4] = {
+            premultiply(paletteRGB[i * 3 + 0], alpha),
+            premultiply(paletteRGB[i * 3 + 1], alpha),
+            premultiply(paletteRGB[i * 3 + 2], alpha),
+            alpha,
+        };
+        std::memcpy(&palette[i], rgba, 4);
+    }
+
+    DecodedImage image;
+    image.width = header.width;
+    image.height = header.height;
+    image.pixels.resize(size_t(header.width) * header.height * 4);
+
+    std::vector<uint8_t> zeroRow(rowBytes);
+    const uint8_t* prev = zeroRow.data();
+    for (uint32_t y = 0; y < header.height; y++) {
+        uint8_t* line = raw.data() + y * stride;
+        uint8_t filter = line[0];
+        if (filter > 4) return std::nullopt;
+
+        uint8_t* row = line + 1;
+        if (filter != 0) {
+            unfilterRow(filter, row, prev, rowBytes, bpp);
+        }
+        // Converted while the row is still in cache
+        convertRow(header, row, image.pixels.data() + size_t(y) * header.width * 4, palette);
+        prev = row;
+    }
+    return image;
+}
+
+std::optional<std::pair<uint32_t, uint32_t>> readPngSize(const uint8_t* data, size_t size) {
+    if (size < 24 || std::memcmp(data, SIGNATURE, 8) != 0 || std::memcmp(data + 12, "IHDR", 4) != 0) {
+        return std::nullopt;
+    }
+    return std::make_pair(readU32(data + 16), readU32(data + 20));
+}
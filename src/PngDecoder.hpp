@@ -0,0 +1,17 @@
+#pragma once
+
+#include "DecodedImage.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+// Decodes non-interlaced 8-bit PNGs (RGB, RGBA, grey, grey + alpha) and
+// palette PNGs of any bit depth straight into premultiplied RGBA, one row
+// at a time. Returns nullopt for anything else, including data that isn't a
+// PNG, so the caller can fall back to CCImage. Safe to call off the main thread.
+std::optional<DecodedImage> decodePng(const uint8_t* data, size_t size);
+
+// Width and height from a PNG's header, without decoding it. Only needs the
+// first 24 bytes of the file.
+std::optional<std::pair<uint32_t, uint32_t>> readPngSize(const uint8_t* data, size_t size);
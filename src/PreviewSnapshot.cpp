@@ -0,0 +1,74 @@
+#include "PreviewSnapshot.hpp"
+#include <cmath>
+
+PreviewSnapshot* PreviewSnapshot::create(float scale) {
+    auto ret = new PreviewSnapshot();
+    if (ret && ret->init(scale)) {
+        ret->autorelease();
+        return ret;
+    }
+    CC_SAFE_DELETE(ret);
+    return nullptr;
+}
+
+bool PreviewSnapshot::init(float scale) {
+    if (!CCSprite::init()) return false;
+    m_scale = scale;
+    // Render targets come out upside down
+    this->setFlipY(true);
+    return true;
+}
+
+CCRenderTexture* PreviewSnapshot::renderTarget(const CCSize& size) {
+    // Never freed: it is small, and the next level wants the same one
+    static CCRenderTexture* target = nullptr;
+    static CCSize targetSize;
+
+    if (target && targetSize.equals(size)) return target;
+    CC_SAFE_RELEASE_NULL(target);
+    target = CCRenderTexture::create(static_cast<int>(size.width), static_cast<int>(size.height));
+    CC_SAFE_RETAIN(target);
+    targetSize = size;
+    return target;
+}
+
+void PreviewSnapshot::capture(CCNode* source) {
+    m_source = source;
+    m_captured = std::chrono::steady_clock::now();
+
+    auto winSize = CCDirector::sharedDirector()->getWinSize();
+    auto* target = renderTarget({ std::ceil(winSize.width * m_scale), std::ceil(winSize.height * m_scale) });
+    if (!target) return;
+
+    auto* texture = target->getSprite()->getTexture();
+    if (this->getTexture() != texture) {
+        this->setTexture(texture);
+        this->setTextureRect({ CCPointZero, texture->getContentSize() });
+        this->setBlendFunc({ GL_ONE, GL_ONE_MINUS_SRC_ALPHA });
+    }
+
+    // The target is reused, so last time's picture has to go
+    target->beginWithClear(0, 0, 0, 0);
+    if (source) {
+        // The target maps points to its texels 1:1 from the origin, so the
+        // level is scaled down to land inside it
+        kmGLPushMatrix();
+        kmGLScalef(m_scale, m_scale, 1.0f);
+        source->visit();
+        kmGLPopMatrix();
+    }
+    target->end();
+}
+
+void PreviewSnapshot::setRefreshRate(int fps) {
+    using namespace std::chrono;
+    m_interval = fps > 0 ? duration_cast<steady_clock::duration>(seconds(1)) / fps : steady_clock::duration {};
+}
+
+void PreviewSnapshot::visit() {
+    if (m_bVisible && m_source && m_interval.count() > 0
+        && std::chrono::steady_clock::now() - m_captured >= m_interval) {
+        capture(m_source);
+    }
+    CCSprite::visit();
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Geode/Geode.hpp>
+#include <chrono>
+
+using namespace geode::prelude;
+
+// The shrunken picture of the level behind the PiP while it is being
+// positioned. The level is drawn straight at preview size into one render
+// target shared by every PlayLayer, which is only recreated when the preview
+// size changes, so opening the preview never allocates a framebuffer after
+// the first time.
+class PreviewSnapshot : public CCSprite {
+public:
+    // `scale` is the preview size as a fraction of the window
+    static PreviewSnapshot* create(float scale);
+
+    // Draws `source` into the render target. A source set here is redrawn
+    // by the live refresh until the next capture.
+    void capture(CCNode* source);
+    // Redraws while visible at most `fps` times a second; 0 turns it off.
+    // Driven from visit(), so it keeps going while the director is paused.
+    void setRefreshRate(int fps);
+
+    void visit() override;
+
+protected:
+    bool init(float scale);
+
+private:
+    static CCRenderTexture* renderTarget(const CCSize& size);
+
+    float m_scale = 1.0f;
+    CCNode* m_source = nullptr;
+    std::chrono::steady_clock::duration m_interval {};
+    std::chrono::steady_clock::time_point m_captured;
+};
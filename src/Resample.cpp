@@ -0,0 +1,151 @@
+#include "Resample.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define CDI_RESAMPLE_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define CDI_RESAMPLE_NEON
+#endif
+
+namespace {
+    // One RGBA pixel as four float lanes
+#if defined(CDI_RESAMPLE_SSE2)
+    using Pixel = __m128;
+
+    inline Pixel zero() { return _mm_setzero_ps(); }
+    inline Pixel loadBytes(const uint8_t* src) {
+        int32_t packed;
+        std::memcpy(&packed, src, 4);
+        auto z = _mm_setzero_si128();
+        auto wide = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), z), z);
+        return _mm_cvtepi32_ps(wide);
+    }
+    inline Pixel loadFloats(const float* src) { return _mm_loadu_ps(src); }
+    inline Pixel addScaled(Pixel acc, Pixel value, float weight) {
+        return _mm_add_ps(acc, _mm_mul_ps(value, _mm_set1_ps(weight)));
+    }
+    inline void storeFloats(float* dst, Pixel value) { _mm_storeu_ps(dst, value); }
+    inline void storeBytes(uint8_t* dst, Pixel value) {
+        auto rounded = _mm_cvtps_epi32(value);
+        auto packed = _mm_packus_epi16(_mm_packs_epi32(rounded, rounded), rounded);
+        int32_t out = _mm_cvtsi128_si32(packed);
+        std::memcpy(dst, &out, 4);
+    }
+#elif defined(CDI_RESAMPLE_NEON)
+    using Pixel = float32x4_t;
+
+    inline Pixel zero() { return vdupq_n_f32(0.0f); }
+    inline Pixel loadBytes(const uint8_t* src) {
+        uint32_t packed;
+        std::memcpy(&packed, src, 4);
+        auto wide = vmovl_u16(vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(packed)))));
+        return vcvtq_f32_u32(wide);
+    }
+    inline Pixel loadFloats(const float* src) { return vld1q_f32(src); }
+    inline Pixel addScaled(Pixel acc, Pixel value, float weight) {
+        return vmlaq_n_f32(acc, value, weight);
+    }
+    inline void storeFloats(float* dst, Pixel value) { vst1q_f32(dst, value); }
+    inline void storeBytes(uint8_t* dst, Pixel value) {
+        auto narrow = vqmovn_u16(vcombine_u16(vqmovn_u32(vcvtnq_u32_f32(value)), vdup_n_u16(0)));
+        uint32_t out = vget_lane_u32(vreinterpret_u32_u8(narrow), 0);
+        std::memcpy(dst, &out, 4);
+    }
+#else
+    struct Pixel {
+        float v[4];
+    };
+
+    inline Pixel zero() { return {}; }
+    inline Pixel loadBytes(const uint8_t* src) { return { { float(src[0]), float(src[1]), float(src[2]), float(src[3]) } }; }
+    inline Pixel loadFloats(const float* src) { return { { src[0], src[1], src[2], src[3] } }; }
+    inline Pixel addScaled(Pixel acc, Pixel value, float weight) {
+        for (int i = 0; i < 4; i++) acc.v[i] += value.v[i] * weight;
+        return acc;
+    }
+    inline void storeFloats(float* dst, Pixel value) { std::memcpy(dst, value.v, sizeof(value.v)); }
+    inline void storeBytes(uint8_t* dst, Pixel value) {
+        for (int i = 0; i < 4; i++) {
+            dst[i] = static_cast<uint8_t>(std::clamp(std::lround(value.v[i]), 0l, 255l));
+        }
+    }
+#endif
+
+    // Which source pixels each output pixel along one axis covers, and how much
+    struct Contributions {
+        std::vector<uint32_t> first;
+        std::vector<uint32_t> offset;
+        std::vector<float> weights;
+
+        Contributions(uint32_t srcLength, uint32_t dstLength) {
+            double scale = static_cast<double>(srcLength) / dstLength;
+            for (uint32_t d = 0; d < dstLength; d++) {
+                double start = d * scale;
+                double end = std::min<double>((d + 1) * scale, srcLength);
+                auto i = static_cast<uint32_t>(start);
+
+                first.push_back(i);
+                offset.push_back(static_cast<uint32_t>(weights.size()));
+                for (; i < end; i++) {
+                    double covered = std::min<double>(i + 1, end) - std::max<double>(i, start);
+                    weights.push_back(static_cast<float>(covered / scale));
+                }
+            }
+            offset.push_back(static_cast<uint32_t>(weights.size()));
+        }
+
+        uint32_t count(uint32_t d) const { return offset[d + 1] - offset[d]; }
+    };
+
+    void resampleRow(const uint8_t* src, const Contributions& columns, uint32_t dstWidth, float* dst) {
+        for (uint32_t x = 0; x < dstWidth; x++) {
+            auto* pixel = src + columns.first[x] * 4;
+            auto* weight = columns.weights.data() + columns.offset[x];
+            auto acc = zero();
+            for (uint32_t i = 0, n = columns.count(x); i < n; i++) {
+                acc = addScaled(acc, loadBytes(pixel + i * 4), weight[i]);
+            }
+            storeFloats(dst + x * 4, acc);
+        }
+    }
+}
+
+void resampleArea(
+    const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight,
+    uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight
+) {
+    Contributions columns(srcWidth, dstWidth);
+    Contributions rows(srcHeight, dstHeight);
+
+    size_t rowFloats = static_cast<size_t>(dstWidth) * 4;
+    std::vector<float> acc(rowFloats);
+    std::vector<float> row(rowFloats);
+    // A source row that straddles two output rows is only resampled once
+    uint32_t cachedRow = UINT32_MAX;
+
+    for (uint32_t y = 0; y < dstHeight; y++) {
+        std::fill(acc.begin(), acc.end(), 0.0f);
+
+        auto* weight = rows.weights.data() + rows.offset[y];
+        for (uint32_t i = 0, n = rows.count(y); i < n; i++) {
+            uint32_t sy = rows.first[y] + i;
+            if (sy != cachedRow) {
+                resampleRow(src + static_cast<size_t>(sy) * srcWidth * 4, columns, dstWidth, row.data());
+                cachedRow = sy;
+            }
+            for (size_t f = 0; f < rowFloats; f += 4) {
+                storeFloats(acc.data() + f, addScaled(loadFloats(acc.data() + f), loadFloats(row.data() + f), weight[i]));
+            }
+        }
+
+        auto* out = dst + static_cast<size_t>(y) * dstWidth * 4;
+        for (uint32_t x = 0; x < dstWidth; x++) {
+            storeBytes(out + x * 4, loadFloats(acc.data() + x * 4));
+        }
+    }
+}
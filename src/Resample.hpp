@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+// Shrinks premultiplied RGBA8 pixels from srcWidth x srcHeight down to
+// dstWidth x dstHeight by averaging the source area each output pixel covers.
+// The destination must not be larger than the source in either dimension.
+// Uses SSE2 on x86-64 and NEON on arm64, which both targets always have.
+void resampleArea(
+    const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight,
+    uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight
+);
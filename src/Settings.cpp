@@ -0,0 +1,159 @@
+#include "Settings.hpp"
+#include "AssetScan.hpp"
+#include <Geode/Geode.hpp>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+using namespace geode::prelude;
+
+namespace {
+    // More folders go in extra-folder-paths, separated by semicolons or new lines
+    std::vector<std::filesystem::path> parseFolderRoots(const std::string& main, const std::string& extra) {
+        std::vector<std::filesystem::path> roots;
+        if (!main.empty()) roots.emplace_back(main);
+        size_t pos = 0;
+        while (pos <= extra.size()) {
+            size_t next = std::min(extra.find_first_of(";\n", pos), extra.size());
+            auto root = extra.substr(pos, next - pos);
+            root.erase(0, root.find_first_not_of(" \t\r"));
+            root.erase(root.find_last_not_of(" \t\r") + 1);
+            if (!root.empty()) roots.emplace_back(std::move(root));
+            pos = next + 1;
+        }
+        return roots;
+    }
+
+    // Only ever accessed through std::atomic_load/atomic_exchange
+    std::shared_ptr<const Settings> s_current = std::make_shared<const Settings>();
+    // Replaced this frame; a reference from get() further up the stack may
+    // still point into one of them
+    std::vector<std::shared_ptr<const Settings>> s_retired;
+    std::vector<Settings::Listener> s_listeners;
+    int s_batchDepth = 0;
+    bool s_stale = false;
+
+    void publish(std::shared_ptr<const Settings> settings) {
+        const Settings* current = settings.get();
+        const Settings* previous = s_retired.emplace_back(std::atomic_exchange(&s_current, std::move(settings))).get();
+        if (s_retired.size() == 1) {
+            Loader::get()->queueInMainThread([] { s_retired.clear(); });
+        }
+        // By index, since a listener may add another
+        for (size_t i = 0; i < s_listeners.size(); i++) {
+            s_listeners[i](*current, previous);
+        }
+    }
+}
+
+const Settings& Settings::get() {
+    // s_current only changes on the main thread, which is the one reading it here
+    return *s_current;
+}
+
+std::shared_ptr<const Settings> Settings::snapshot() {
+    return std::atomic_load(&s_current);
+}
+
+void Settings::reload() {
+    auto* mod = Mod::get();
+    auto settings = std::make_shared<Settings>(get());
+
+    settings->enabled = mod->getSettingValue<bool>("enabled");
+    settings->soundVolume = static_cast<float>(mod->getSettingValue<double>("sound-volume"));
+    settings->rareChance = static_cast<int>(mod->getSettingValue<int64_t>("rare-chance"));
+
+    settings->pipMode = mod->getSettingValue<bool>("pip-mode");
+    settings->pipPosition = static_cast<int>(mod->getSettingValue<int64_t>("pip-position"));
+    settings->pipOffsetX = static_cast<int>(mod->getSettingValue<int64_t>("pip-offset-x"));
+    settings->pipOffsetY = static_cast<int>(mod->getSettingValue<int64_t>("pip-offset-y"));
+    settings->pipSize = static_cast<int>(mod->getSettingValue<int64_t>("pip-size"));
+    settings->pipSizeMultiplier = static_cast<float>(mod->getSettingValue<double>("pip-size-multiplier"));
+    settings->pipPadding = static_cast<int>(mod->getSettingValue<int64_t>("pip-padding"));
+    settings->pipUseCustomImage = mod->getSettingValue<bool>("pip-use-custom-image");
+    settings->pipImagePath = mod->getSettingValue<std::string>("pip-image-path");
+    settings->hasCustomPosition = mod->getSettingValue<bool>("has-custom-position");
+    settings->pipPositionX = static_cast<float>(mod->getSettingValue<double>("pip-position-x"));
+    settings->pipPositionY = static_cast<float>(mod->getSettingValue<double>("pip-position-y"));
+    settings->previewLiveRefresh = mod->getSettingValue<bool>("pip-preview-live-refresh");
+    settings->previewRefreshRate = static_cast<int>(mod->getSettingValue<int64_t>("pip-preview-refresh-rate"));
+
+    settings->memeMode = mod->getSettingValue<bool>("meme-mode");
+    settings->useCustomImage = mod->getSettingValue<bool>("use-custom-image");
+    settings->useFolder = mod->getSettingValue<bool>("use-folder");
+    settings->showInPractice = mod->getSettingValue<bool>("show-in-practice");
+    auto customImagePath = mod->getSettingValue<std::string>("custom-image-path");
+    if (customImagePath != settings->customImagePath) {
+        settings->customImagePath = std::move(customImagePath);
+        settings->customImageSoundPath = settings->customImagePath.empty()
+            ? std::filesystem::path() : findMatchingSoundFile(settings->customImagePath);
+    }
+    settings->customFolderPath = mod->getSettingValue<std::string>("custom-folder-path");
+    settings->folderRoots = parseFolderRoots(
+        settings->customFolderPath, mod->getSettingValue<std::string>("extra-folder-paths")
+    );
+    settings->scanSubfolders = mod->getSettingValue<bool>("scan-subfolders");
+    settings->minPercentage = static_cast<int>(mod->getSettingValue<int64_t>("min-percentage"));
+    settings->deathDuration = static_cast<float>(mod->getSettingValue<double>("death-duration"));
+    auto overlap = mod->getSettingValue<std::string>("death-overlap");
+    settings->deathOverlap = overlap == "Queue" ? DeathOverlap::Queue
+        : overlap == "Ignore" ? DeathOverlap::Ignore : DeathOverlap::Restart;
+
+    settings->useCustomSound = mod->getSettingValue<bool>("use-custom-sound");
+    settings->customSoundPath = mod->getSettingValue<std::string>("custom-sound-path");
+    settings->useImageSpecificSounds = mod->getSettingValue<bool>("use-image-specific-sounds");
+
+    settings->loadingPlaceholder = mod->getSettingValue<bool>("loading-placeholder");
+    settings->perfHud = mod->getSettingValue<bool>("perf-hud");
+    settings->traceDeaths = mod->getSettingValue<bool>("trace-deaths");
+    settings->deathFrameBudget = static_cast<float>(mod->getSettingValue<double>("death-frame-budget"));
+    settings->textureCacheSize = mod->getSettingValue<int64_t>("texture-cache-size");
+
+    publish(std::move(settings));
+}
+
+void Settings::listen(Listener listener) {
+    listener(get(), nullptr);
+    s_listeners.push_back(std::move(listener));
+}
+
+Settings::Batch::Batch() {
+    ++s_batchDepth;
+}
+
+Settings::Batch::~Batch() {
+    if (--s_batchDepth == 0 && s_stale) {
+        s_stale = false;
+        Settings::reload();
+    }
+}
+
+$on_mod(Loaded) {
+    auto* mod = Mod::get();
+    auto resources = mod->getResourcesDir();
+
+    // Only changes when the mod loads, so the copy constructor carries it into every reload
+    auto base = std::make_shared<Settings>();
+    base->defaultImagePath = resources / "death.png";
+    base->defaultSoundPath = resources / "death.ogg";
+    base->jumpscareSoundPath = resources / "jumpsc.mp3";
+    base->defaultPiPImagePath = resources / "livereact.png";
+    publish(std::move(base));
+
+    Settings::reload();
+    listenForAllSettingChanges([](std::shared_ptr<SettingV3>) {
+        if (s_batchDepth > 0) {
+            s_stale = true;
+            return;
+        }
+        Settings::reload();
+    });
+
+    // Other mods may load after us, so check for Globed once everything is up
+    Loader::get()->queueInMainThread([] {
+        auto settings = std::make_shared<Settings>(Settings::get());
+        settings->globedLoaded = Loader::get()->getLoadedMod("geode.globed") != nullptr;
+        publish(std::move(settings));
+    });
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// What a death does while the last death image is still showing
+enum class DeathOverlap { Restart, Queue, Ignore };
+
+// Typed copy of every mod setting. A new snapshot is built whenever a setting
+// changes and published with an atomic shared_ptr swap, so the death handler
+// reads plain fields and worker threads can read the same snapshot safely.
+// A replaced snapshot is freed on the next frame, or once the last
+// snapshot() holding it lets go, whichever is later.
+struct Settings {
+    bool enabled = true;
+    float soundVolume = 1.0f;
+    int rareChance = 1;
+
+    bool pipMode = false;
+    int pipPosition = 0;
+    int pipOffsetX = 0;
+    int pipOffsetY = 0;
+    int pipSize = 20;
+    float pipSizeMultiplier = 1.0f;
+    int pipPadding = 10;
+    bool pipUseCustomImage = false;
+    std::string pipImagePath;
+    bool hasCustomPosition = false;
+    float pipPositionX = 0.5f;
+    float pipPositionY = 0.5f;
+    // Live redraw of the level behind the positioning preview, capped in frames per second
+    bool previewLiveRefresh = false;
+    int previewRefreshRate = 4;
+
+    bool memeMode = false;
+    bool useCustomImage = false;
+    bool useFolder = false;
+    bool showInPractice = false;
+    std::string customImagePath;
+    // The .ogg or .mp3 next to customImagePath, looked up when that changes
+    std::filesystem::path customImageSoundPath;
+    std::string customFolderPath;
+    // custom-folder-path, then each of extra-folder-paths, leaving out empty ones
+    std::vector<std::filesystem::path> folderRoots;
+    bool scanSubfolders = true;
+    int minPercentage = 0;
+    float deathDuration = 1.0f;
+    DeathOverlap deathOverlap = DeathOverlap::Restart;
+
+    bool useCustomSound = false;
+    std::string customSoundPath;
+    bool useImageSpecificSounds = false;
+
+    bool loadingPlaceholder = false;
+    // Milliseconds the death handler may take before deferring work
+    float deathFrameBudget = 4.0f;
+    int64_t textureCacheSize = 128;
+    bool perfHud = false;
+    bool traceDeaths = false;
+
+    // Resolved once when the mod loads rather than per death
+    bool globedLoaded = false;
+    std::filesystem::path defaultImagePath;
+    std::filesystem::path defaultSoundPath;
+    std::filesystem::path jumpscareSoundPath;
+    std::filesystem::path defaultPiPImagePath;
+
+    // Valid until the next frame, even if a setting changes meanwhile. Main
+    // thread only.
+    static const Settings& get();
+    // For holding on longer, or from another thread
+    static std::shared_ptr<const Settings> snapshot();
+    // Rebuilds the snapshot from the mod's current setting values. Main thread only.
+    static void reload();
+
+    // Called on the main thread with every snapshot published from now on,
+    // and straight away with the current one and a null `previous`, so each
+    // listener can apply just what changed
+    using Listener = std::function<void(const Settings& settings, const Settings* previous)>;
+    static void listen(Listener listener);
+
+    // While one is alive, setting changes only mark the snapshot stale; it is
+    // rebuilt once when the last batch ends.
+    struct Batch {
+        Batch();
+        ~Batch();
+        Batch(const Batch&) = delete;
+        Batch& operator=(const Batch&) = delete;
+    };
+};
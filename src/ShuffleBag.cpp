@@ -0,0 +1,28 @@
+#include "ShuffleBag.hpp"
+#include <algorithm>
+
+void ShuffleBag::reset(size_t size) {
+    m_order.resize(size);
+    for (size_t i = 0; i < size; i++) {
+        m_order[i] = i;
+    }
+    m_last.reset();
+    reshuffle();
+}
+
+void ShuffleBag::reshuffle() {
+    std::shuffle(m_order.begin(), m_order.end(), m_gen);
+    if (m_order.size() > 1 && m_last && m_order.front() == *m_last) {
+        std::uniform_int_distribution<size_t> dis(1, m_order.size() - 1);
+        std::swap(m_order.front(), m_order[dis(m_gen)]);
+    }
+    m_pos = 0;
+}
+
+size_t ShuffleBag::next() {
+    if (m_pos >= m_order.size()) {
+        reshuffle();
+    }
+    m_last = m_order[m_pos++];
+    return *m_last;
+}
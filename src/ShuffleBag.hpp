@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <random>
+#include <vector>
+
+// Hands out every index in [0, size) once, in random order, before starting a
+// new round. A new round never starts with the index that ended the last one.
+class ShuffleBag {
+public:
+    void reset(size_t size);
+    size_t next();
+    size_t size() const { return m_order.size(); }
+
+private:
+    void reshuffle();
+
+    std::vector<size_t> m_order;
+    size_t m_pos = 0;
+    std::optional<size_t> m_last;
+    std::mt19937 m_gen { std::random_device{}() };
+};
@@ -0,0 +1,252 @@
+#include "SoundBank.hpp"
+#include <algorithm>
+
+SoundBank* SoundBank::get() {
+    // Never released: the scheduler entry lives for the whole session
+    static auto* instance = new SoundBank();
+    return instance;
+}
+
+SoundBank::SoundBank() {
+    CCDirector::sharedDirector()->getScheduler()->scheduleUpdateForTarget(this, 0, false);
+}
+
+FMOD::ChannelGroup* SoundBank::group() {
+    if (!m_group) {
+        auto* engine = FMODAudioEngine::sharedEngine();
+        if (engine->m_system->createChannelGroup("CustomDeathImage", &m_group) != FMOD_OK) {
+            log::error("Failed to create the death sound channel group");
+            m_group = nullptr;
+        }
+    }
+    return m_group;
+}
+
+SoundBank::Sample* SoundBank::acquireSample(const std::string& path) {
+    if (auto it = m_samples.find(path); it != m_samples.end()) {
+        m_hits++;
+        auto& sample = it->second;
+        if (sample.refs++ == 0) {
+            m_idle.erase(sample.idlePos);
+            m_idleBytes -= sample.bytes;
+        }
+        return &sample;
+    }
+
+    m_misses++;
+    auto* engine = FMODAudioEngine::sharedEngine();
+    FMOD::Sound* sound = nullptr;
+    if (engine->m_system->createSound(path.c_str(), FMOD_DEFAULT | FMOD_CREATESAMPLE, nullptr, &sound) != FMOD_OK || !sound) {
+        log::error("Failed to load sound: {}", path);
+        return nullptr;
+    }
+
+    unsigned int bytes = 0;
+    sound->getLength(&bytes, FMOD_TIMEUNIT_PCMBYTES);
+
+    auto& sample = m_samples[path];
+    sample.sound = sound;
+    sample.bytes = bytes;
+    sample.refs = 1;
+    m_residentBytes += bytes;
+    return &sample;
+}
+
+void SoundBank::releaseSample(const std::string& path) {
+    auto it = m_samples.find(path);
+    if (it == m_samples.end() || --it->second.refs > 0) return;
+
+    m_idle.push_front(path);
+    it->second.idlePos = m_idle.begin();
+    m_idleBytes += it->second.bytes;
+    trimIdle();
+}
+
+void SoundBank::trimIdle() {
+    while (m_idleBytes > IDLE_BUDGET_BYTES && !m_idle.empty()) {
+        auto it = m_samples.find(m_idle.back());
+        m_idle.pop_back();
+        if (it == m_samples.end()) continue;
+
+        m_idleBytes -= it->second.bytes;
+        m_residentBytes -= it->second.bytes;
+        it->second.sound->release();
+        m_samples.erase(it);
+    }
+}
+
+void SoundBank::preload(const std::filesystem::path& path) {
+    if (path.empty()) return;
+    auto key = path.string();
+
+    if (auto it = m_samples.find(key); it != m_samples.end()) {
+        if (it->second.refs == 0) {
+            m_idle.splice(m_idle.begin(), m_idle, it->second.idlePos);
+        }
+        return;
+    }
+
+    std::error_code ec;
+    auto fileSize = std::filesystem::file_size(path, ec);
+    if (ec || fileSize > SAMPLE_MAX_FILE_BYTES) return;
+
+    if (acquireSample(key)) {
+        releaseSample(key);
+    }
+}
+
+bool SoundBank::startVoice(const std::string& path, float volume, Voice& voice) {
+    voice.path = path;
+
+    bool isSample = m_samples.contains(path);
+    if (!isSample) {
+        std::error_code ec;
+        auto fileSize = std::filesystem::file_size(path, ec);
+        if (ec) return false;
+        isSample = fileSize <= SAMPLE_MAX_FILE_BYTES;
+    }
+
+    auto* engine = FMODAudioEngine::sharedEngine();
+    FMOD::Sound* sound = nullptr;
+    if (isSample) {
+        auto* sample = acquireSample(path);
+        if (!sample) return false;
+        sound = sample->sound;
+        voice.isSample = true;
+    } else {
+        if (engine->m_system->createStream(path.c_str(), FMOD_DEFAULT, nullptr, &sound) != FMOD_OK || !sound) {
+            log::error("Failed to open sound stream: {}", path);
+            return false;
+        }
+        voice.stream = sound;
+    }
+
+    // Start paused so the volume is in place before the first sample plays
+    if (engine->m_system->playSound(sound, group(), true, &voice.channel) != FMOD_OK || !voice.channel) {
+        endVoice(voice, false);
+        return false;
+    }
+    voice.channel->setVolume(volume);
+    return true;
+}
+
+FMOD::Channel* SoundBank::trigger(Voice voice, float volume) {
+    if (m_voices.size() >= MAX_VOICES) {
+        endVoice(m_voices.front(), true);
+        m_voices.erase(m_voices.begin());
+    }
+
+    voice.channel->setVolume(volume);
+    voice.triggeredAt = std::chrono::steady_clock::now();
+    voice.channel->setPaused(false);
+
+    m_voices.push_back(voice);
+    return voice.channel;
+}
+
+FMOD::Channel* SoundBank::play(const std::filesystem::path& path, float volume) {
+    if (path.empty()) return nullptr;
+    auto key = path.string();
+
+    auto armed = std::find_if(m_armed.begin(), m_armed.end(), [&](const Voice& voice) {
+        return voice.path == key;
+    });
+    if (armed != m_armed.end()) {
+        Voice voice = *armed;
+        m_armed.erase(armed);
+
+        // FMOD can steal or invalidate a channel that sat paused for a while
+        bool paused = false;
+        if (voice.channel->getPaused(&paused) == FMOD_OK && paused) {
+            voice.wasArmed = true;
+            return trigger(voice, volume);
+        }
+        endVoice(voice, true);
+    }
+
+    Voice voice;
+    if (!startVoice(key, volume, voice)) return nullptr;
+    return trigger(voice, volume);
+}
+
+void SoundBank::arm(const std::vector<std::filesystem::path>& paths, float volume) {
+    std::vector<std::string> keys;
+    for (const auto& path : paths) {
+        if (!path.empty()) keys.push_back(path.string());
+    }
+
+    std::erase_if(m_armed, [&](Voice& voice) {
+        if (std::find(keys.begin(), keys.end(), voice.path) != keys.end()) return false;
+        endVoice(voice, true);
+        return true;
+    });
+
+    for (const auto& key : keys) {
+        auto existing = std::find_if(m_armed.begin(), m_armed.end(), [&](const Voice& voice) {
+            return voice.path == key;
+        });
+        if (existing != m_armed.end()) {
+            existing->channel->setVolume(volume);
+            continue;
+        }
+
+        Voice voice;
+        if (startVoice(key, volume, voice)) {
+            m_armed.push_back(voice);
+        }
+    }
+}
+
+void SoundBank::disarm() {
+    for (auto& voice : m_armed) {
+        endVoice(voice, true);
+    }
+    m_armed.clear();
+}
+
+void SoundBank::endVoice(Voice& voice, bool stop) {
+    if (stop && voice.channel) {
+        voice.channel->stop();
+    }
+    if (voice.stream) {
+        voice.stream->release();
+        voice.stream = nullptr;
+    } else if (voice.isSample) {
+        releaseSample(voice.path);
+        voice.isSample = false;
+    }
+    voice.channel = nullptr;
+}
+
+void SoundBank::stopAll() {
+    for (auto& voice : m_voices) {
+        endVoice(voice, true);
+    }
+    m_voices.clear();
+}
+
+void SoundBank::update(float) {
+    auto now = std::chrono::steady_clock::now();
+
+    std::erase_if(m_voices, [&](Voice& voice) {
+        bool playing = false;
+        if (voice.channel->isPlaying(&playing) != FMOD_OK || !playing) {
+            endVoice(voice, false);
+            return true;
+        }
+
+        if (voice.triggeredAt) {
+            unsigned int position = 0;
+            if (voice.channel->getPosition(&position, FMOD_TIMEUNIT_MS) == FMOD_OK && position > 0) {
+                // Back out however much already played since the mixer picked it up
+                auto elapsed = std::chrono::duration<double, std::milli>(now - *voice.triggeredAt).count();
+                log::info(
+                    "Death sound audible {:.1f} ms after trigger ({}): {}",
+                    std::max(0.0, elapsed - position), voice.wasArmed ? "armed" : "cold", voice.path
+                );
+                voice.triggeredAt.reset();
+            }
+        }
+        return false;
+    });
+}
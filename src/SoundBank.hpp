@@ -0,0 +1,90 @@
+#pragma once
+
+#include <Geode/Geode.hpp>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace geode::prelude;
+
+// Owns every FMOD sound the mod plays. Short clips are decoded into memory
+// once and shared; long ones are streamed per playback. Sounds are
+// reference-counted by the voices playing them, and idle samples stay cached
+// (LRU, byte-capped) until something else needs the room.
+//
+// Playback goes through the mod's own channel group so stopping death sounds
+// never touches the game's effects.
+class SoundBank : public CCObject {
+public:
+    // Clips bigger than this on disk are streamed instead of fully decoded
+    static constexpr size_t SAMPLE_MAX_FILE_BYTES = 512 * 1024;
+    static constexpr size_t IDLE_BUDGET_BYTES = 32 * 1024 * 1024;
+    static constexpr size_t MAX_VOICES = 4;
+
+    static SoundBank* get();
+
+    // Decodes a short clip ahead of time so playing it later doesn't touch the disk.
+    void preload(const std::filesystem::path& path);
+    // Plays `path` in the mod's channel group; the oldest voice is cut if the cap is hit.
+    // Uses the armed voice for `path` if there is one.
+    FMOD::Channel* play(const std::filesystem::path& path, float volume);
+    // Stops every voice started with play(); armed voices stay armed.
+    void stopAll();
+
+    // Loads each of `paths` into a paused channel with `volume` applied, so
+    // that playing it on death is only an unpause. Replaces the previous set.
+    void arm(const std::vector<std::filesystem::path>& paths, float volume);
+    void disarm();
+
+    size_t getResidentBytes() const { return m_residentBytes; }
+    size_t getVoiceCount() const { return m_voices.size(); }
+    // Short clips found decoded already, and ones that had to be decoded
+    uint64_t getHits() const { return m_hits; }
+    uint64_t getMisses() const { return m_misses; }
+
+    void update(float dt) override;
+
+private:
+    struct Sample {
+        FMOD::Sound* sound = nullptr;
+        size_t bytes = 0;
+        int refs = 0;
+        std::list<std::string>::iterator idlePos;
+    };
+
+    struct Voice {
+        FMOD::Channel* channel = nullptr;
+        std::string path;
+        // Either a shared sample (by path) or a stream owned by this voice
+        bool isSample = false;
+        FMOD::Sound* stream = nullptr;
+        // Set while waiting for the first samples to play, to log the latency
+        std::optional<std::chrono::steady_clock::time_point> triggeredAt;
+        bool wasArmed = false;
+    };
+
+    SoundBank();
+    FMOD::ChannelGroup* group();
+    Sample* acquireSample(const std::string& path);
+    void releaseSample(const std::string& path);
+    bool startVoice(const std::string& path, float volume, Voice& voice);
+    void endVoice(Voice& voice, bool stop);
+    FMOD::Channel* trigger(Voice voice, float volume);
+    void trimIdle();
+
+    FMOD::ChannelGroup* m_group = nullptr;
+    std::unordered_map<std::string, Sample> m_samples;
+    // Samples nobody is playing, front is most recently used
+    std::list<std::string> m_idle;
+    std::vector<Voice> m_voices;
+    std::vector<Voice> m_armed;
+    size_t m_residentBytes = 0;
+    size_t m_idleBytes = 0;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+};
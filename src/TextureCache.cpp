@@ -0,0 +1,154 @@
+#include "TextureCache.hpp"
+#include "Settings.hpp"
+
+size_t TextureKeyHash::operator()(const TextureKey& key) const {
+    size_t h = std::hash<std::string>{}(key.path);
+    h ^= std::hash<int64_t>{}(key.mtime) + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    h ^= std::hash<uint64_t>{}(key.size) + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    h ^= std::hash<std::string>{}(key.variant()) + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    return h;
+}
+
+std::string TextureKey::variant() const {
+    return fmt::format("{}@{}x{}{}", path, target.width, target.height, target.mipmaps ? "m" : "");
+}
+
+TextureCache& TextureCache::get() {
+    static TextureCache instance;
+    return instance;
+}
+
+TextureKey TextureCache::makeKey(const std::filesystem::path& path, const ImageTarget& target) {
+    TextureKey key;
+    key.path = path.string();
+    key.target = target;
+
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    if (!ec) {
+        key.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+    }
+    auto size = std::filesystem::file_size(path, ec);
+    if (!ec) {
+        key.size = static_cast<uint64_t>(size);
+    }
+    return key;
+}
+
+uint64_t TextureCache::hashContents(const uint8_t* data, size_t size) {
+    // FNV-1a, good enough to tell duplicate images apart
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash ^ size;
+}
+
+uint64_t TextureCache::sharedId(uint64_t contentHash, const ImageTarget& target) {
+    // Identical files only share a texture when they are drawn at the same size
+    uint64_t id = contentHash;
+    for (uint64_t part : { uint64_t(target.width), uint64_t(target.height), uint64_t(target.mipmaps) }) {
+        id ^= part + 0x9e3779b97f4a7c15ull + (id << 6) + (id >> 2);
+    }
+    return id;
+}
+
+CCTexture2D* TextureCache::find(const std::filesystem::path& path, const ImageTarget& target) {
+    auto latest = m_latest.find(TextureKey { path.string(), 0, 0, target }.variant());
+    auto it = latest == m_latest.end() ? m_entries.end() : m_entries.find(latest->second);
+    if (it == m_entries.end()) {
+        m_misses++;
+        return nullptr;
+    }
+
+    m_hits++;
+    touch(it->second);
+    return m_textures[it->second.sharedId].texture;
+}
+
+std::optional<TextureKey> TextureCache::keyFor(const std::filesystem::path& path, const ImageTarget& target) const {
+    auto latest = m_latest.find(TextureKey { path.string(), 0, 0, target }.variant());
+    if (latest == m_latest.end()) return std::nullopt;
+    return latest->second;
+}
+
+CCTexture2D* TextureCache::findByContents(uint64_t contentHash, const ImageTarget& target) const {
+    auto it = m_textures.find(sharedId(contentHash, target));
+    return it == m_textures.end() ? nullptr : it->second.texture;
+}
+
+CCTexture2D* TextureCache::insert(const TextureKey& key, uint64_t contentHash, CCTexture2D* texture) {
+    auto id = sharedId(contentHash, key.target);
+    auto& shared = m_textures[id];
+    if (!shared.texture) {
+        texture->retain();
+        shared.texture = texture;
+        shared.bytes = static_cast<size_t>(texture->getPixelsWide()) * texture->getPixelsHigh()
+            * texture->bitsPerPixelForFormat() / 8;
+        m_residentBytes += shared.bytes;
+    }
+    shared.refs++;
+
+    if (auto it = m_entries.find(key); it != m_entries.end()) {
+        dropEntry(it);
+    }
+    m_lru.push_front(key);
+    m_entries[key] = Entry { id, m_lru.begin() };
+    m_latest[key.variant()] = key;
+
+    evict(&key);
+    return shared.texture;
+}
+
+void TextureCache::touch(Entry& entry) {
+    m_lru.splice(m_lru.begin(), m_lru, entry.lruPos);
+}
+
+void TextureCache::evict(const TextureKey* keep) {
+    while (m_residentBytes + m_reservedBytes > m_budget && !m_lru.empty()) {
+        auto& victim = m_lru.back();
+        if (keep && victim == *keep) break;
+        dropEntry(m_entries.find(victim));
+    }
+}
+
+void TextureCache::dropEntry(std::unordered_map<TextureKey, Entry, TextureKeyHash>::iterator it) {
+    if (it == m_entries.end()) return;
+
+    auto shared = m_textures.find(it->second.sharedId);
+    if (auto latest = m_latest.find(it->first.variant()); latest != m_latest.end() && latest->second == it->first) {
+        m_latest.erase(latest);
+    }
+    m_lru.erase(it->second.lruPos);
+    m_entries.erase(it);
+
+    if (shared != m_textures.end() && --shared->second.refs <= 0) {
+        m_residentBytes -= shared->second.bytes;
+        shared->second.texture->release();
+        m_textures.erase(shared);
+    }
+}
+
+void TextureCache::setBudget(size_t bytes) {
+    m_budget = bytes;
+    evict(nullptr);
+}
+
+void TextureCache::setReservedBytes(size_t bytes) {
+    m_reservedBytes = bytes;
+    evict(nullptr);
+}
+
+void TextureCache::clear() {
+    while (!m_lru.empty()) {
+        dropEntry(m_entries.find(m_lru.back()));
+    }
+}
+
+$on_mod(Loaded) {
+    Settings::listen([](const Settings& settings, const Settings* previous) {
+        if (previous && previous->textureCacheSize == settings.textureCacheSize) return;
+        TextureCache::get().setBudget(static_cast<size_t>(settings.textureCacheSize) * 1024 * 1024);
+    });
+}
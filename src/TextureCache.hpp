@@ -0,0 +1,97 @@
+#pragma once
+
+#include "ImageDecoder.hpp"
+#include <Geode/Geode.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+using namespace geode::prelude;
+
+// Identifies one version of an image file on disk, at one target size. A
+// changed mtime or size makes the old entry unreachable. find() doesn't stat
+// the file, though: an edit only shows once AsyncLoader's background
+// revalidation has cached the new version, usually the death after.
+struct TextureKey {
+    std::string path;
+    int64_t mtime = 0;
+    uint64_t size = 0;
+    ImageTarget target;
+
+    bool operator==(const TextureKey&) const = default;
+
+    // Names the file at this target size, whatever version of it is on disk
+    std::string variant() const;
+};
+
+struct TextureKeyHash {
+    size_t operator()(const TextureKey& key) const;
+};
+
+// Keeps decoded death/PiP textures alive between deaths. Entries are evicted
+// least-recently-used once the resident texture bytes exceed the budget, and
+// files with identical contents share a single CCTexture2D.
+class TextureCache {
+public:
+    static TextureCache& get();
+
+    // Texture most recently cached for `path` at `target`, without touching
+    // the disk. The cache owns the returned texture; anything that keeps it
+    // around (e.g. a sprite) must retain it.
+    CCTexture2D* find(const std::filesystem::path& path, const ImageTarget& target);
+    // Key the texture returned by find() was cached under, if any.
+    std::optional<TextureKey> keyFor(const std::filesystem::path& path, const ImageTarget& target) const;
+    // Texture already uploaded for these file contents at `target`, if any.
+    CCTexture2D* findByContents(uint64_t contentHash, const ImageTarget& target) const;
+
+    // Adds a texture for `key`. If another file with the same contents is
+    // cached already, that texture is shared and returned instead.
+    CCTexture2D* insert(const TextureKey& key, uint64_t contentHash, CCTexture2D* texture);
+
+    void setBudget(size_t bytes);
+    size_t getBudget() const { return m_budget; }
+    size_t getResidentBytes() const { return m_residentBytes; }
+    // Texture bytes held outside the cache (the ImageAtlas pages) that still
+    // count against the budget
+    void setReservedBytes(size_t bytes);
+    size_t getReservedBytes() const { return m_reservedBytes; }
+    // find() calls that did and didn't have a texture, this session
+    uint64_t getHits() const { return m_hits; }
+    uint64_t getMisses() const { return m_misses; }
+    void clear();
+
+    static TextureKey makeKey(const std::filesystem::path& path, const ImageTarget& target);
+    static uint64_t hashContents(const uint8_t* data, size_t size);
+
+private:
+    struct Entry {
+        uint64_t sharedId;
+        std::list<TextureKey>::iterator lruPos;
+    };
+
+    struct SharedTexture {
+        CCTexture2D* texture = nullptr;
+        size_t bytes = 0;
+        int refs = 0;
+    };
+
+    static uint64_t sharedId(uint64_t contentHash, const ImageTarget& target);
+    void touch(Entry& entry);
+    void evict(const TextureKey* keep);
+    void dropEntry(std::unordered_map<TextureKey, Entry, TextureKeyHash>::iterator it);
+
+    std::unordered_map<TextureKey, Entry, TextureKeyHash> m_entries;
+    std::unordered_map<uint64_t, SharedTexture> m_textures;
+    // Keyed by TextureKey::variant()
+    std::unordered_map<std::string, TextureKey> m_latest;
+    // Front is most recently used.
+    std::list<TextureKey> m_lru;
+    size_t m_budget = 128ull * 1024 * 1024;
+    size_t m_residentBytes = 0;
+    size_t m_reservedBytes = 0;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+};
@@ -0,0 +1,154 @@
+#include "ThumbnailCache.hpp"
+#include "AnimatedImage.hpp"
+#include "ImageDecoder.hpp"
+#include "ThumbnailStore.hpp"
+#include "Trace.hpp"
+#include <Geode/Geode.hpp>
+#include <Geode/utils/file.hpp>
+#include <algorithm>
+#include <optional>
+
+using namespace geode::prelude;
+
+namespace {
+    struct FileStamp {
+        int64_t mtime;
+        uint64_t size;
+    };
+
+    std::optional<FileStamp> stampOf(const std::filesystem::path& path) {
+        std::error_code ec;
+        auto size = std::filesystem::file_size(path, ec);
+        if (ec) return std::nullopt;
+        auto mtime = std::filesystem::last_write_time(path, ec);
+        if (ec) return std::nullopt;
+        return FileStamp { static_cast<int64_t>(mtime.time_since_epoch().count()), size };
+    }
+}
+
+ThumbnailCache& ThumbnailCache::get() {
+    // Never destroyed: the workers live for the whole session
+    static auto* instance = new ThumbnailCache();
+    return *instance;
+}
+
+ThumbnailCache::ThumbnailCache() {
+    unsigned count = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 2u);
+    for (unsigned i = 0; i < count; i++) {
+        std::thread(&ThumbnailCache::work, this).detach();
+    }
+}
+
+void ThumbnailCache::request(const std::filesystem::path& path, Callback callback) {
+    // An image edited since its thumbnail was kept is made again
+    if (auto stamp = stampOf(path)) {
+        if (auto thumbnail = ThumbnailStore::get().find(path, stamp->mtime, stamp->size)) {
+            callback(std::move(thumbnail));
+            return;
+        }
+    }
+
+    auto key = path.string();
+    {
+        std::lock_guard lock(m_mutex);
+        auto& callbacks = m_callbacks[key];
+        callbacks.push_back(std::move(callback));
+
+        if (auto it = std::find(m_queue.begin(), m_queue.end(), key); it != m_queue.end()) {
+            m_queue.erase(it);
+        } else if (callbacks.size() > 1) {
+            // A worker has it already
+            return;
+        }
+        m_queue.push_back(key);
+
+        while (m_queue.size() > MAX_QUEUED) {
+            m_callbacks.erase(m_queue.front());
+            m_queue.pop_front();
+        }
+    }
+    m_wake.notify_one();
+}
+
+void ThumbnailCache::prewarm(const std::filesystem::path& path) {
+    if (ThumbnailStore::get().find(path)) return;
+    request(path, [](std::shared_ptr<const DecodedImage>) {});
+}
+
+void ThumbnailCache::cancelPending() {
+    std::lock_guard lock(m_mutex);
+    for (auto& key : m_queue) {
+        m_callbacks.erase(key);
+    }
+    m_queue.clear();
+}
+
+size_t ThumbnailCache::pending() {
+    std::lock_guard lock(m_mutex);
+    return m_queue.size();
+}
+
+void ThumbnailCache::work() {
+    Trace::setThreadName("thumbnails");
+    while (true) {
+        std::string key;
+        {
+            std::unique_lock lock(m_mutex);
+            m_wake.wait(lock, [this] { return !m_queue.empty(); });
+            key = std::move(m_queue.back());
+            m_queue.pop_back();
+        }
+
+        auto thumbnail = make(key);
+
+        std::vector<Callback> callbacks;
+        {
+            std::lock_guard lock(m_mutex);
+            auto it = m_callbacks.find(key);
+            if (it == m_callbacks.end()) continue;
+            callbacks = std::move(it->second);
+            m_callbacks.erase(it);
+        }
+        Loader::get()->queueInMainThread([callbacks = std::move(callbacks), thumbnail] {
+            for (auto& callback : callbacks) {
+                callback(thumbnail);
+            }
+        });
+    }
+}
+
+std::shared_ptr<const DecodedImage> ThumbnailCache::make(const std::filesystem::path& path) {
+    std::call_once(m_opened, [this] {
+        m_file.open(Mod::get()->getSaveDir() / "thumbnails.cdit");
+    });
+
+    auto stamp = stampOf(path);
+    if (!stamp) return nullptr;
+
+    auto key = path.string();
+    if (auto stored = m_file.read(key, stamp->mtime, stamp->size)) {
+        std::shared_ptr<const DecodedImage> thumbnail = std::move(stored);
+        ThumbnailStore::get().insert(path, stamp->mtime, stamp->size, thumbnail);
+        return thumbnail;
+    }
+
+    std::optional<DecodedImage> image;
+    {
+        ScopedTrace trace(TracePhase::Decode);
+        auto data = geode::utils::file::readBinary(path);
+        if (!data.isOk()) return nullptr;
+        auto& bytes = data.unwrap();
+
+        if (auto decoder = openAnimation(bytes.data(), bytes.size())) {
+            if (decoder->advance()) image = decoder->canvas();
+        }
+        if (!image) image = decodeImage(bytes.data(), bytes.size());
+    }
+    if (!image) return nullptr;
+
+    auto& store = ThumbnailStore::get();
+    store.put(path, stamp->mtime, stamp->size, image->pixels.data(), image->width, image->height);
+    auto thumbnail = store.find(path, stamp->mtime, stamp->size);
+    if (thumbnail) m_file.append(key, stamp->mtime, stamp->size, *thumbnail);
+    return thumbnail;
+}
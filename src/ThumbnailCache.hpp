@@ -0,0 +1,58 @@
+#pragma once
+
+#include "DecodedImage.hpp"
+#include "ThumbnailFile.hpp"
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Makes thumbnails on request for the gallery and the PiP position preview.
+// Requests are served from the ThumbnailStore, then from thumbnails.cdit in
+// the save dir, and only then by decoding the image on a background thread,
+// so each image is decoded once across sessions.
+class ThumbnailCache {
+public:
+    // Requests beyond this drop the oldest ones; a scrolling grid keeps
+    // asking for what just came into view, and what it asked for first has
+    // usually left it again
+    static constexpr size_t MAX_QUEUED = 128;
+
+    using Callback = std::function<void(std::shared_ptr<const DecodedImage>)>;
+
+    static ThumbnailCache& get();
+
+    // Calls `callback` on the main thread with the thumbnail of `path`, or
+    // nullptr if it can't be decoded. Thumbnails already in memory, and made
+    // from the file as it is now, are handed over before this returns. The
+    // newest request is served first. Main thread only.
+    void request(const std::filesystem::path& path, Callback callback);
+    // Gets the thumbnail of `path` into ThumbnailStore ahead of time, from
+    // thumbnails.cdit when it is there, unless some version of it already is.
+    // Main thread only.
+    void prewarm(const std::filesystem::path& path);
+    // Drops requests no worker has picked up yet, without calling them back
+    void cancelPending();
+
+    size_t pending();
+
+private:
+    ThumbnailCache();
+    void work();
+    std::shared_ptr<const DecodedImage> make(const std::filesystem::path& path);
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    // Newest at the back
+    std::deque<std::string> m_queue;
+    std::unordered_map<std::string, std::vector<Callback>> m_callbacks;
+
+    std::once_flag m_opened;
+    ThumbnailFile m_file;
+};
@@ -0,0 +1,230 @@
+#include "ThumbnailFile.hpp"
+#include <cstring>
+#include <vector>
+
+namespace {
+    constexpr char MAGIC[4] = { 'C', 'D', 'I', 'T' };
+
+    // Pixels are premultiplied, so a channel never exceeds its alpha and
+    // rounding each one separately keeps it that way
+    uint16_t pack4444(const uint8_t* p) {
+        auto q = [](uint8_t v) { return static_cast<uint16_t>((v * 15 + 127) / 255); };
+        return static_cast<uint16_t>(q(p[0]) << 12 | q(p[1]) << 8 | q(p[2]) << 4 | q(p[3]));
+    }
+
+    uint16_t pack565(const uint8_t* p) {
+        return static_cast<uint16_t>(
+            ((p[0] * 31 + 127) / 255) << 11 | ((p[1] * 63 + 127) / 255) << 5 | ((p[2] * 31 + 127) / 255)
+        );
+    }
+
+    void unpack(ThumbnailFormat format, const std::vector<uint8_t>& packed, DecodedImage& image) {
+        size_t count = size_t(image.width) * image.height;
+        image.pixels.resize(count * 4);
+        auto* dst = image.pixels.data();
+        for (size_t i = 0; i < count; i++) {
+            uint16_t v = static_cast<uint16_t>(packed[i * 2] | packed[i * 2 + 1] << 8);
+            if (format == ThumbnailFormat::RGB565) {
+                dst[i * 4 + 0] = static_cast<uint8_t>((v >> 11) * 255 / 31);
+                dst[i * 4 + 1] = static_cast<uint8_t>((v >> 5 & 63) * 255 / 63);
+                dst[i * 4 + 2] = static_cast<uint8_t>((v & 31) * 255 / 31);
+                dst[i * 4 + 3] = 255;
+            } else {
+                dst[i * 4 + 0] = static_cast<uint8_t>((v >> 12) * 17);
+                dst[i * 4 + 1] = static_cast<uint8_t>((v >> 8 & 15) * 17);
+                dst[i * 4 + 2] = static_cast<uint8_t>((v >> 4 & 15) * 17);
+                dst[i * 4 + 3] = static_cast<uint8_t>((v & 15) * 17);
+            }
+        }
+    }
+}
+
+bool ThumbnailFile::open(const std::filesystem::path& path) {
+    std::lock_guard lock(m_mutex);
+    m_path = path;
+    m_entries.clear();
+    m_file.close();
+    m_file.clear();
+
+    std::error_code ec;
+    auto bytes = std::filesystem::file_size(path, ec);
+    if (ec || bytes > MAX_FILE_BYTES) return reset();
+
+    m_file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!m_file || !index()) return reset();
+
+    uint64_t liveBytes = m_end - m_deadBytes;
+    if (m_deadBytes > liveBytes && m_deadBytes > (4u << 20)) compact();
+    return true;
+}
+
+bool ThumbnailFile::reset() {
+    m_entries.clear();
+    m_deadBytes = 0;
+    m_file.close();
+    m_file.clear();
+    m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!m_file) return false;
+
+    ThumbnailFileHeader header {};
+    std::memcpy(header.magic, MAGIC, 4);
+    header.version = VERSION;
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_end = sizeof(header);
+    return m_file.good();
+}
+
+bool ThumbnailFile::index() {
+    std::error_code ec;
+    auto fileEnd = static_cast<uint64_t>(std::filesystem::file_size(m_path, ec));
+    if (ec) return false;
+
+    ThumbnailFileHeader header {};
+    if (!m_file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    if (std::memcmp(header.magic, MAGIC, 4) != 0 || header.version != VERSION) return false;
+
+    uint64_t offset = sizeof(header);
+    std::string path;
+    ThumbnailRecord record {};
+    while (m_file.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+        uint64_t end = offset + sizeof(record) + record.pathLength + pixelBytes(record);
+        path.resize(record.pathLength);
+        bool known = record.format == ThumbnailFormat::RGB565 || record.format == ThumbnailFormat::RGBA4444;
+        if (!known || end > fileEnd || !m_file.read(path.data(), record.pathLength)) break;
+        m_file.seekg(static_cast<std::streamoff>(end));
+
+        auto [it, inserted] = m_entries.try_emplace(path, Entry { offset, record });
+        if (!inserted) {
+            m_deadBytes += sizeof(record) + it->second.record.pathLength + pixelBytes(it->second.record);
+            it->second = Entry { offset, record };
+        }
+        offset = end;
+    }
+
+    // A record cut short by a crash mid-write is dropped
+    if (offset != fileEnd) {
+        m_file.close();
+        std::filesystem::resize_file(m_path, offset, ec);
+        m_file.clear();
+        m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary);
+        if (ec || !m_file) return false;
+    }
+    m_end = offset;
+    return true;
+}
+
+void ThumbnailFile::compact() {
+    auto tempPath = m_path;
+    tempPath += ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+
+    ThumbnailFileHeader header {};
+    std::memcpy(header.magic, MAGIC, 4);
+    header.version = VERSION;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    uint64_t offset = sizeof(header);
+    std::vector<char> buffer;
+    std::vector<std::pair<Entry*, uint64_t>> moved;
+    moved.reserve(m_entries.size());
+    for (auto& [path, entry] : m_entries) {
+        buffer.resize(sizeof(ThumbnailRecord) + entry.record.pathLength + pixelBytes(entry.record));
+        m_file.clear();
+        m_file.seekg(static_cast<std::streamoff>(entry.offset));
+        if (!m_file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()))) return;
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        moved.emplace_back(&entry, offset);
+        offset += buffer.size();
+    }
+    out.close();
+    if (!out) return;
+
+    m_file.close();
+    std::error_code ec;
+    std::filesystem::rename(tempPath, m_path, ec);
+    m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary);
+    if (ec || !m_file) {
+        reset();
+        return;
+    }
+    for (auto [entry, newOffset] : moved) {
+        entry->offset = newOffset;
+    }
+    m_end = offset;
+    m_deadBytes = 0;
+}
+
+std::shared_ptr<DecodedImage> ThumbnailFile::read(const std::string& imagePath, int64_t mtime, uint64_t size) {
+    std::lock_guard lock(m_mutex);
+    auto it = m_entries.find(imagePath);
+    if (it == m_entries.end()) return nullptr;
+    auto& [offset, record] = it->second;
+    if (record.mtime != mtime || record.size != size) return nullptr;
+
+    std::vector<uint8_t> packed(pixelBytes(record));
+    m_file.clear();
+    m_file.seekg(static_cast<std::streamoff>(offset + sizeof(record) + record.pathLength));
+    if (!m_file.read(reinterpret_cast<char*>(packed.data()), static_cast<std::streamsize>(packed.size()))) {
+        return nullptr;
+    }
+
+    auto image = std::make_shared<DecodedImage>();
+    image->width = record.width;
+    image->height = record.height;
+    unpack(record.format, packed, *image);
+    return image;
+}
+
+void ThumbnailFile::append(const std::string& imagePath, int64_t mtime, uint64_t size, const DecodedImage& thumbnail) {
+    if (imagePath.size() > UINT16_MAX || thumbnail.width > UINT16_MAX || thumbnail.height > UINT16_MAX) return;
+
+    ThumbnailRecord record {};
+    record.mtime = mtime;
+    record.size = size;
+    record.width = static_cast<uint16_t>(thumbnail.width);
+    record.height = static_cast<uint16_t>(thumbnail.height);
+    record.pathLength = static_cast<uint16_t>(imagePath.size());
+
+    size_t count = size_t(thumbnail.width) * thumbnail.height;
+    auto* src = thumbnail.pixels.data();
+    record.format = ThumbnailFormat::RGB565;
+    for (size_t i = 0; i < count; i++) {
+        if (src[i * 4 + 3] != 255) {
+            record.format = ThumbnailFormat::RGBA4444;
+            break;
+        }
+    }
+
+    std::vector<uint8_t> packed(count * 2);
+    for (size_t i = 0; i < count; i++) {
+        auto v = record.format == ThumbnailFormat::RGB565 ? pack565(src + i * 4) : pack4444(src + i * 4);
+        packed[i * 2] = static_cast<uint8_t>(v);
+        packed[i * 2 + 1] = static_cast<uint8_t>(v >> 8);
+    }
+
+    std::lock_guard lock(m_mutex);
+    if (!m_file.is_open()) return;
+    uint64_t bytes = sizeof(record) + imagePath.size() + packed.size();
+    if (m_end + bytes > MAX_FILE_BYTES && m_deadBytes > 0) compact();
+    if (m_end + bytes > MAX_FILE_BYTES && !reset()) return;
+
+    m_file.clear();
+    m_file.seekp(static_cast<std::streamoff>(m_end));
+    m_file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    m_file.write(imagePath.data(), static_cast<std::streamsize>(imagePath.size()));
+    m_file.write(reinterpret_cast<const char*>(packed.data()), static_cast<std::streamsize>(packed.size()));
+    m_file.flush();
+    if (!m_file) return;
+
+    auto [it, inserted] = m_entries.try_emplace(imagePath, Entry { m_end, record });
+    if (!inserted) {
+        m_deadBytes += sizeof(record) + it->second.record.pathLength + pixelBytes(it->second.record);
+        it->second = Entry { m_end, record };
+    }
+    m_end += sizeof(record) + imagePath.size() + packed.size();
+}
+
+size_t ThumbnailFile::size() const {
+    std::lock_guard lock(m_mutex);
+    return m_entries.size();
+}
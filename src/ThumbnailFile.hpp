@@ -0,0 +1,82 @@
+#pragma once
+
+#include "DecodedImage.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// On-disk layout of thumbnails.cdit: the header, then one record per
+// thumbnail in the order they were made. A record is followed by its image
+// path and its pixels. Little-endian.
+struct ThumbnailFileHeader {
+    char magic[4];
+    uint32_t version;
+};
+
+enum class ThumbnailFormat : uint8_t {
+    RGB565 = 1,
+    RGBA4444 = 2,
+};
+
+struct ThumbnailRecord {
+    // Of the image the thumbnail was made from
+    int64_t mtime;
+    uint64_t size;
+    uint16_t width;
+    uint16_t height;
+    uint16_t pathLength;
+    ThumbnailFormat format;
+    uint8_t padding;
+};
+
+static_assert(sizeof(ThumbnailFileHeader) == 8);
+static_assert(sizeof(ThumbnailRecord) == 24);
+
+// Thumbnails kept between sessions, so a big folder only has to be decoded
+// once. New thumbnails are appended; one made for an image that changed
+// replaces the old record, which stays in the file as dead space until the
+// next open compacts it. Opaque thumbnails are stored as RGB565 and the rest
+// as RGBA4444. Safe to use from any thread.
+class ThumbnailFile {
+public:
+    static constexpr uint32_t VERSION = 1;
+    // An append that would pass this compacts the file first, and starts it
+    // over if that doesn't free enough, rather than growing without end
+    static constexpr uint64_t MAX_FILE_BYTES = 256ull << 20;
+
+    // Indexes the file at `path`, creating it if it is missing or unreadable.
+    // Reads every record header, so call it off the main thread.
+    bool open(const std::filesystem::path& path);
+
+    // The thumbnail made from the image at `imagePath` when it had this mtime
+    // and size, or nullptr if there is none
+    std::shared_ptr<DecodedImage> read(const std::string& imagePath, int64_t mtime, uint64_t size);
+    void append(const std::string& imagePath, int64_t mtime, uint64_t size, const DecodedImage& thumbnail);
+
+    size_t size() const;
+
+private:
+    struct Entry {
+        uint64_t offset;
+        ThumbnailRecord record;
+    };
+
+    static uint64_t pixelBytes(const ThumbnailRecord& record) {
+        return uint64_t(record.width) * record.height * 2;
+    }
+    bool index();
+    void compact();
+    bool reset();
+
+    mutable std::mutex m_mutex;
+    std::filesystem::path m_path;
+    std::fstream m_file;
+    // Keyed by image path
+    std::unordered_map<std::string, Entry> m_entries;
+    uint64_t m_end = 0;
+    uint64_t m_deadBytes = 0;
+};
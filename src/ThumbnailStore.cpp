@@ -0,0 +1,67 @@
+#include "ThumbnailStore.hpp"
+#include "Resample.hpp"
+#include <algorithm>
+
+ThumbnailStore& ThumbnailStore::get() {
+    static ThumbnailStore instance;
+    return instance;
+}
+
+void ThumbnailStore::put(
+    const std::filesystem::path& path, int64_t mtime, uint64_t size, const uint8_t* pixels, uint32_t width,
+    uint32_t height
+) {
+    if (!width || !height) return;
+
+    // Fit inside the square, keeping the aspect ratio the full image has
+    auto longest = std::max(width, height);
+    auto thumbnail = std::make_shared<DecodedImage>();
+    thumbnail->width = std::max<uint32_t>(1, static_cast<uint32_t>(uint64_t(width) * THUMBNAIL_SIZE / longest));
+    thumbnail->height = std::max<uint32_t>(1, static_cast<uint32_t>(uint64_t(height) * THUMBNAIL_SIZE / longest));
+    if (longest <= THUMBNAIL_SIZE) {
+        thumbnail->width = width;
+        thumbnail->height = height;
+        thumbnail->pixels.assign(pixels, pixels + size_t(width) * height * 4);
+    } else {
+        thumbnail->pixels.resize(size_t(thumbnail->width) * thumbnail->height * 4);
+        resampleArea(pixels, width, height, thumbnail->pixels.data(), thumbnail->width, thumbnail->height);
+    }
+    insert(path, mtime, size, std::move(thumbnail));
+}
+
+void ThumbnailStore::insert(
+    const std::filesystem::path& path, int64_t mtime, uint64_t size, std::shared_ptr<const DecodedImage> thumbnail
+) {
+    auto key = path.string();
+    std::lock_guard lock(m_mutex);
+    if (auto it = m_entries.find(key); it != m_entries.end()) {
+        it->second.image = std::move(thumbnail);
+        it->second.mtime = mtime;
+        it->second.size = size;
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lruPos);
+        return;
+    }
+
+    m_lru.push_front(key);
+    m_entries[key] = Entry { std::move(thumbnail), mtime, size, m_lru.begin() };
+    while (m_entries.size() > MAX_THUMBNAILS) {
+        m_entries.erase(m_lru.back());
+        m_lru.pop_back();
+    }
+}
+
+std::shared_ptr<const DecodedImage> ThumbnailStore::find(const std::filesystem::path& path) {
+    std::lock_guard lock(m_mutex);
+    auto it = m_entries.find(path.string());
+    if (it == m_entries.end()) return nullptr;
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lruPos);
+    return it->second.image;
+}
+
+std::shared_ptr<const DecodedImage> ThumbnailStore::find(const std::filesystem::path& path, int64_t mtime, uint64_t size) {
+    std::lock_guard lock(m_mutex);
+    auto it = m_entries.find(path.string());
+    if (it == m_entries.end() || it->second.mtime != mtime || it->second.size != size) return nullptr;
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lruPos);
+    return it->second.image;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "DecodedImage.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Tiny copies of recently decoded images. They outlive the full textures the
+// TextureCache evicts, so a death whose image isn't loaded can still show a
+// preview straight away. Safe to use from any thread; the loader's workers
+// fill it as they decode.
+class ThumbnailStore {
+public:
+    // Longest side of a thumbnail, in pixels
+    static constexpr uint32_t THUMBNAIL_SIZE = 64;
+    // At most 16 KB each, so about 4 MB in all
+    static constexpr size_t MAX_THUMBNAILS = 256;
+
+    static ThumbnailStore& get();
+
+    // Shrinks premultiplied RGBA pixels and keeps the result for `path`,
+    // replacing any older thumbnail of it. `mtime` and `size` are of the
+    // image file the pixels were decoded from.
+    void put(
+        const std::filesystem::path& path, int64_t mtime, uint64_t size, const uint8_t* pixels, uint32_t width,
+        uint32_t height
+    );
+    // Keeps a thumbnail made elsewhere, already within THUMBNAIL_SIZE
+    void insert(
+        const std::filesystem::path& path, int64_t mtime, uint64_t size, std::shared_ptr<const DecodedImage> thumbnail
+    );
+    // Whichever version of the image the kept thumbnail was made from
+    std::shared_ptr<const DecodedImage> find(const std::filesystem::path& path);
+    // Only a thumbnail made from the file with this mtime and size
+    std::shared_ptr<const DecodedImage> find(const std::filesystem::path& path, int64_t mtime, uint64_t size);
+
+private:
+    struct Entry {
+        std::shared_ptr<const DecodedImage> image;
+        int64_t mtime;
+        uint64_t size;
+        std::list<std::string>::iterator lruPos;
+    };
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_entries;
+    // Front is most recently used
+    std::list<std::string> m_lru;
+};
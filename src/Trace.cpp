@@ -0,0 +1,235 @@
+#include "Trace.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+
+namespace {
+    // Fields are relaxed atomics so the collector can read a slot while its
+    // owner overwrites it; the torn copies that produces are thrown away
+    struct Slot {
+        std::atomic<uint64_t> start = 0;
+        std::atomic<uint64_t> duration = 0;
+        std::atomic<uint32_t> thread = 0;
+        std::atomic<uint8_t> phase = 0;
+    };
+
+    struct Ring {
+        // Events ever written; only the owning thread stores to it
+        std::atomic<uint64_t> head = 0;
+        // Collector only, under s_mutex
+        uint64_t read = 0;
+        bool leased = false;
+        std::array<Slot, Trace::RING_SIZE> slots;
+    };
+
+    std::mutex s_mutex;
+    // Never freed: a ring outlives its thread until the next one takes it over
+    std::vector<Ring*> s_rings;
+    std::vector<std::string> s_names;
+
+    // A thread's ring, taken on its first event and handed back when it exits,
+    // so short-lived threads don't each leave one behind
+    struct Lease {
+        Ring* ring = nullptr;
+        uint32_t thread = 0;
+        std::string name;
+
+        ~Lease() {
+            if (!ring) return;
+            std::lock_guard lock(s_mutex);
+            ring->leased = false;
+        }
+
+        Ring* acquire() {
+            std::lock_guard lock(s_mutex);
+            auto it = std::find_if(s_rings.begin(), s_rings.end(), [](Ring* ring) { return !ring->leased; });
+            if (it != s_rings.end()) {
+                ring = *it;
+            } else {
+                ring = new Ring();
+                s_rings.push_back(ring);
+            }
+            ring->leased = true;
+            thread = static_cast<uint32_t>(s_names.size());
+            s_names.push_back(name);
+            return ring;
+        }
+    };
+
+    thread_local Lease t_lease;
+
+    struct Latency {
+        std::atomic<uint64_t> last = 0;
+        std::atomic<uint64_t> worst = 0;
+    };
+    std::array<Latency, static_cast<size_t>(TracePhase::Count)> s_latency;
+
+    double percentile(const std::vector<uint64_t>& sorted, double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+        return static_cast<double>(sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1]) / 1e6;
+    }
+
+    void appendEscaped(std::string& out, const std::string& text) {
+        for (char c : text) {
+            if (c == '"' || c == '\\') out += '\\';
+            if (static_cast<unsigned char>(c) >= 0x20) out += c;
+        }
+    }
+}
+
+const char* tracePhaseName(TracePhase phase) {
+    switch (phase) {
+        case TracePhase::Death: return "death";
+        case TracePhase::Pick: return "pick";
+        case TracePhase::Scan: return "scan";
+        case TracePhase::Display: return "display";
+        case TracePhase::Read: return "read";
+        case TracePhase::Decode: return "decode";
+        case TracePhase::Upload: return "upload";
+        case TracePhase::Sprite: return "sprite";
+        case TracePhase::Sound: return "sound";
+        case TracePhase::PiP: return "pip";
+        default: return "unknown";
+    }
+}
+
+uint64_t Trace::now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count());
+}
+
+void Trace::record(TracePhase phase, uint64_t start, uint64_t end) {
+    uint64_t duration = end - start;
+    auto& latency = s_latency[static_cast<size_t>(phase)];
+    latency.last.store(duration, std::memory_order_relaxed);
+    uint64_t worst = latency.worst.load(std::memory_order_relaxed);
+    while (duration > worst && !latency.worst.compare_exchange_weak(worst, duration, std::memory_order_relaxed)) {}
+    if (!recording()) return;
+
+    auto& lease = t_lease;
+    auto* ring = lease.ring ? lease.ring : lease.acquire();
+
+    uint64_t index = ring->head.load(std::memory_order_relaxed);
+    auto& slot = ring->slots[index % RING_SIZE];
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.duration.store(duration, std::memory_order_relaxed);
+    slot.thread.store(lease.thread, std::memory_order_relaxed);
+    slot.phase.store(static_cast<uint8_t>(phase), std::memory_order_relaxed);
+    ring->head.store(index + 1, std::memory_order_release);
+}
+
+PhaseLatency Trace::latency(TracePhase phase) {
+    auto& latency = s_latency[static_cast<size_t>(phase)];
+    return { latency.last.load(std::memory_order_relaxed), latency.worst.load(std::memory_order_relaxed) };
+}
+
+void Trace::resetLatency() {
+    for (auto& latency : s_latency) {
+        latency.last.store(0, std::memory_order_relaxed);
+        latency.worst.store(0, std::memory_order_relaxed);
+    }
+}
+
+void Trace::setThreadName(const char* name) {
+    auto& lease = t_lease;
+    lease.name = name;
+    if (!lease.ring) return;
+    std::lock_guard lock(s_mutex);
+    s_names[lease.thread] = name;
+}
+
+std::vector<TraceEvent> Trace::collect() {
+    std::vector<TraceEvent> events;
+    std::lock_guard lock(s_mutex);
+    for (auto* ring : s_rings) {
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t from = std::max(ring->read, head > RING_SIZE ? head - RING_SIZE : 0);
+        size_t first = events.size();
+        for (uint64_t i = from; i < head; i++) {
+            auto& slot = ring->slots[i % RING_SIZE];
+            events.push_back({
+                static_cast<TracePhase>(slot.phase.load(std::memory_order_relaxed)),
+                slot.thread.load(std::memory_order_relaxed),
+                slot.start.load(std::memory_order_relaxed),
+                slot.duration.load(std::memory_order_relaxed),
+            });
+        }
+        ring->read = head;
+
+        // The owner may have lapped the oldest of those while they were copied
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = ring->head.load(std::memory_order_relaxed);
+        if (after >= RING_SIZE && after - RING_SIZE + 1 > from) {
+            uint64_t torn = std::min(after - RING_SIZE + 1, head) - from;
+            events.erase(events.begin() + first, events.begin() + first + static_cast<ptrdiff_t>(torn));
+        }
+    }
+    return events;
+}
+
+std::vector<std::string> Trace::threadNames() {
+    std::lock_guard lock(s_mutex);
+    return s_names;
+}
+
+std::vector<PhaseStats> summarizeTrace(const std::vector<TraceEvent>& events) {
+    std::array<std::vector<uint64_t>, static_cast<size_t>(TracePhase::Count)> durations;
+    for (auto& event : events) {
+        auto phase = static_cast<size_t>(event.phase);
+        if (phase < durations.size()) durations[phase].push_back(event.duration);
+    }
+
+    std::vector<PhaseStats> stats;
+    for (size_t phase = 0; phase < durations.size(); phase++) {
+        auto& sorted = durations[phase];
+        if (sorted.empty()) continue;
+        std::sort(sorted.begin(), sorted.end());
+
+        PhaseStats entry;
+        entry.phase = static_cast<TracePhase>(phase);
+        entry.count = sorted.size();
+        entry.p50 = percentile(sorted, 0.50);
+        entry.p95 = percentile(sorted, 0.95);
+        entry.p99 = percentile(sorted, 0.99);
+        entry.max = static_cast<double>(sorted.back()) / 1e6;
+        stats.push_back(entry);
+    }
+    return stats;
+}
+
+std::string chromeTraceJson(const std::vector<TraceEvent>& events, const std::vector<std::string>& threadNames) {
+    uint64_t origin = UINT64_MAX;
+    std::vector<bool> seen(threadNames.size());
+    for (auto& event : events) {
+        origin = std::min(origin, event.start);
+        if (event.thread < seen.size()) seen[event.thread] = true;
+    }
+
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    char line[256];
+    for (size_t thread = 0; thread < seen.size(); thread++) {
+        if (!seen[thread]) continue;
+        out += first ? "" : ",\n";
+        first = false;
+        out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(thread) + ",\"args\":{\"name\":\"";
+        appendEscaped(out, threadNames[thread].empty() ? "thread " + std::to_string(thread) : threadNames[thread]);
+        out += "\"}}";
+    }
+    for (auto& event : events) {
+        // Timestamps are in microseconds, counted from the first event
+        std::snprintf(
+            line, sizeof(line), "%s{\"name\":\"%s\",\"cat\":\"death\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+            first ? "" : ",\n", tracePhaseName(event.phase), event.thread,
+            static_cast<double>(event.start - origin) / 1000.0, static_cast<double>(event.duration) / 1000.0
+        );
+        out += line;
+        first = false;
+    }
+    out += "\n]}\n";
+    return out;
+}
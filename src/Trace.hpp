@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The parts of a death that get timed. An enum so recording never touches a
+// string.
+enum class TracePhase : uint8_t {
+    Death,
+    Pick,
+    Scan,
+    Display,
+    Read,
+    Decode,
+    Upload,
+    Sprite,
+    Sound,
+    PiP,
+    Count,
+};
+
+const char* tracePhaseName(TracePhase phase);
+
+struct TraceEvent {
+    TracePhase phase;
+    uint32_t thread;
+    // steady_clock, in nanoseconds
+    uint64_t start;
+    uint64_t duration;
+};
+
+// Last and worst time one phase took, in nanoseconds
+struct PhaseLatency {
+    uint64_t last = 0;
+    uint64_t worst = 0;
+};
+
+// Scoped timers for finding where a slow death spent its time. Each thread
+// records into a fixed ring of its own without locking; collect() copies out
+// what was recorded since it last ran. Watching only keeps each phase's last
+// and worst time, for the perf HUD. While neither is on a timer costs one
+// relaxed load.
+class Trace {
+public:
+    static constexpr size_t RING_SIZE = 1024;
+
+    // Whether timers run at all
+    static bool enabled() { return s_flags.load(std::memory_order_relaxed) != 0; }
+    static bool recording() { return s_flags.load(std::memory_order_relaxed) & RECORDING; }
+    static void setRecording(bool recording) { setFlag(RECORDING, recording); }
+    static void setWatching(bool watching) { setFlag(WATCHING, watching); }
+
+    static PhaseLatency latency(TracePhase phase);
+    static void resetLatency();
+
+    static uint64_t now();
+    static void record(TracePhase phase, uint64_t start, uint64_t end);
+    // Shows up as the thread's name in the Chrome trace
+    static void setThreadName(const char* name);
+
+    // Events recorded since the last call. Events a ring overwrote before
+    // they were collected are lost.
+    static std::vector<TraceEvent> collect();
+    // Thread names by TraceEvent::thread; unnamed threads are empty
+    static std::vector<std::string> threadNames();
+
+private:
+    static constexpr uint8_t RECORDING = 1;
+    static constexpr uint8_t WATCHING = 2;
+
+    static void setFlag(uint8_t flag, bool on) {
+        if (on) s_flags.fetch_or(flag, std::memory_order_relaxed);
+        else s_flags.fetch_and(static_cast<uint8_t>(~flag), std::memory_order_relaxed);
+    }
+
+    static inline std::atomic<uint8_t> s_flags = 0;
+};
+
+class ScopedTrace {
+public:
+    explicit ScopedTrace(TracePhase phase)
+        : m_phase(phase), m_start(Trace::enabled() ? Trace::now() : 0) {}
+    ~ScopedTrace() {
+        if (m_start) Trace::record(m_phase, m_start, Trace::now());
+    }
+    ScopedTrace(const ScopedTrace&) = delete;
+    ScopedTrace& operator=(const ScopedTrace&) = delete;
+
+private:
+    TracePhase m_phase;
+    uint64_t m_start;
+};
+
+struct PhaseStats {
+    TracePhase phase;
+    size_t count = 0;
+    double p50 = 0;
+    double p95 = 0;
+    double p99 = 0;
+    double max = 0;
+};
+
+// Per-phase percentiles, in milliseconds, for phases that have events
+std::vector<PhaseStats> summarizeTrace(const std::vector<TraceEvent>& events);
+
+// Chrome trace_event JSON ("X" events, one track per thread) that Perfetto
+// and chrome://tracing open
+std::string chromeTraceJson(const std::vector<TraceEvent>& events, const std::vector<std::string>& threadNames);
@@ -0,0 +1,58 @@
+#include "TraceReport.hpp"
+#include "Settings.hpp"
+#include <Geode/Geode.hpp>
+#include <fstream>
+
+using namespace geode::prelude;
+
+TraceReport& TraceReport::get() {
+    static TraceReport instance;
+    return instance;
+}
+
+void TraceReport::collect() {
+    if (!Trace::recording()) return;
+
+    auto events = Trace::collect();
+    m_events.insert(m_events.end(), events.begin(), events.end());
+    if (m_events.size() > MAX_EVENTS) {
+        m_events.erase(m_events.begin(), m_events.end() - MAX_EVENTS);
+    }
+}
+
+void TraceReport::report() {
+    if (!Trace::recording()) return;
+    collect();
+    if (m_events.empty()) return;
+
+    log::info("Death trace, {} events (ms):", m_events.size());
+    for (auto& stats : summarizeTrace(m_events)) {
+        log::info(
+            "  {:<8} n={:<6} p50 {:>8.2f}  p95 {:>8.2f}  p99 {:>8.2f}  max {:>8.2f}",
+            tracePhaseName(stats.phase), stats.count, stats.p50, stats.p95, stats.p99, stats.max
+        );
+    }
+
+    auto path = Mod::get()->getSaveDir() / "death-trace.json";
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << chromeTraceJson(m_events, Trace::threadNames());
+    if (!out) {
+        log::error("Failed to write death trace: {}", path.string());
+        return;
+    }
+    log::info("Wrote death trace to {}", path.string());
+}
+
+void TraceReport::clear() {
+    Trace::collect();
+    m_events.clear();
+}
+
+$on_mod(Loaded) {
+    Trace::setThreadName("main");
+    Settings::listen([](const Settings& settings, const Settings* previous) {
+        if (previous && settings.traceDeaths == previous->traceDeaths) return;
+        Trace::setRecording(settings.traceDeaths);
+        if (previous && !settings.traceDeaths) TraceReport::get().clear();
+    });
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Trace.hpp"
+#include <cstddef>
+#include <vector>
+
+// Keeps what Trace recorded this session while `trace-deaths` is on, and
+// reports on it when a level is left: per-phase percentiles go to the log and
+// the whole session is written to death-trace.json in the save dir, for
+// Perfetto or chrome://tracing.
+class TraceReport {
+public:
+    // Oldest events are dropped past this
+    static constexpr size_t MAX_EVENTS = 100000;
+
+    static TraceReport& get();
+
+    // Moves what the threads recorded into the session. Main thread only,
+    // like the rest of this class.
+    void collect();
+    void report();
+    void clear();
+
+private:
+    std::vector<TraceEvent> m_events;
+};
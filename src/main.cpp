@@ -5,126 +5,88 @@
 #include <Geode/utils/file.hpp>
 #include <cocos2d.h>
 #include <filesystem>
-#include <random>
+#include "AsyncLoader.hpp"
+#include "DeathAnimator.hpp"
+#include "DeathBudget.hpp"
+#include "DeathQueue.hpp"
+#include "FolderIndex.hpp"
+#include "ImageAnimation.hpp"
+#include "PerfHud.hpp"
+#include "PiPOverlay.hpp"
+#include "PiPPositionWriter.hpp"
+#include "PreviewSnapshot.hpp"
+#include "Settings.hpp"
+#include "SoundBank.hpp"
+#include "ThumbnailCache.hpp"
+#include "ThumbnailStore.hpp"
+#include "TraceReport.hpp"
 using namespace geode::prelude;
 
-struct MemeAsset {
-    std::filesystem::path imagePath;
-    std::filesystem::path soundPath;
-};
-
-std::vector<std::filesystem::path> getImagesFromFolder(const std::filesystem::path& folderPath) {
-    std::vector<std::filesystem::path> images;
-    
-    if (!std::filesystem::exists(folderPath)) {
-        log::error("Folder does not exist: {}", folderPath.string());
-        return images;
-    }
-    
-    try {
-        for (const auto& entry : std::filesystem::directory_iterator(folderPath)) {
-            if (entry.is_regular_file() && entry.path().extension() == ".png") {
-                images.push_back(entry.path());
-            }
-        }
-    } catch (const std::exception& e) {
-        log::error("Error reading folder: {}", e.what());
-    }
-    
-    return images;
+// Death images are drawn full-screen; the default one scales in from 0.1x, so it gets mipmaps
+ImageTarget deathImageTarget(const std::filesystem::path& imagePath) {
+    auto target = screenTarget();
+    target.mipmaps = imagePath == Settings::get().defaultImagePath;
+    return target;
 }
 
-std::filesystem::path getRandomImage(const std::vector<std::filesystem::path>& images) {
-    if (images.empty()) return "";
+// Loads whatever the next death is going to show while the player is still alive,
+// and arms the sounds it will play so they start on an unpause
+void prewarmNextDeath() {
+    auto& settings = Settings::get();
+    if (!settings.enabled) return;
     
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, images.size() - 1);
-    
-    return images[dis(gen)];
-}
-
-std::filesystem::path findMatchingSoundFile(const std::filesystem::path& imagePath) {
-    auto folder = imagePath.parent_path();
-    auto stem = imagePath.stem().string();
-    
-    std::filesystem::path soundPath = folder / (stem + ".ogg");
-    if (std::filesystem::exists(soundPath)) {
-        return soundPath;
-    }
-    
-    soundPath = folder / (stem + ".mp3");
-    if (std::filesystem::exists(soundPath)) {
-        return soundPath;
-    }
-    
-    return "";
-}
-
-std::vector<MemeAsset> getMemeAssets(const std::filesystem::path& memesPath) {
-    std::vector<MemeAsset> memes;
-    std::map<std::string, MemeAsset> memeMap;
-    
-    if (!std::filesystem::exists(memesPath)) {
-        log::error("Memes folder does not exist: {}", memesPath.string());
-        return memes;
-    }
+    std::vector<std::filesystem::path> sounds;
+    bool customSound = settings.useCustomSound;
     
-    try {
-        for (const auto& entry : std::filesystem::directory_iterator(memesPath)) {
-            if (!entry.is_regular_file()) continue;
-            
-            auto ext = entry.path().extension().string();
-            auto stem = entry.path().stem().string();
-            
-            if (ext == ".png") {
-                memeMap[stem].imagePath = entry.path();
-            }
+    if (settings.memeMode) {
+        if (auto next = DeathQueue::get().prewarm(DeathSource::Memes)) {
+            sounds.push_back(next->soundPath);
+        }
+    } else {
+        if (customSound) {
+            sounds.push_back(settings.customSoundPath);
         }
         
-        for (const auto& entry : std::filesystem::directory_iterator(memesPath)) {
-            if (!entry.is_regular_file()) continue;
-            
-            auto ext = entry.path().extension().string();
-            auto stem = entry.path().stem().string();
-            
-            if (ext == ".mp3" || ext == ".ogg") {
-                if (memeMap.contains(stem) && !memeMap[stem].imagePath.empty()) {
-                    memeMap[stem].soundPath = entry.path();
-                    memes.push_back(memeMap[stem]);
-                }
+        if (!settings.useCustomImage) {
+            AsyncLoader::get()->load(settings.defaultImagePath, deathImageTarget(settings.defaultImagePath));
+            if (!customSound) {
+                sounds.push_back(settings.defaultSoundPath);
+            }
+            sounds.push_back(settings.jumpscareSoundPath);
+        } else if (settings.useFolder) {
+            auto next = DeathQueue::get().prewarm(DeathSource::Folder);
+            if (next && settings.useImageSpecificSounds && !customSound) {
+                sounds.push_back(next->soundPath);
+            }
+        } else {
+            auto customPath = settings.customImagePath;
+            if (!customPath.empty()) {
+                AsyncLoader::get()->load(customPath, deathImageTarget(customPath));
+                ThumbnailCache::get().prewarm(customPath);
+            }
+            if (settings.useImageSpecificSounds && !customSound && !settings.customImageSoundPath.empty()) {
+                sounds.push_back(settings.customImageSoundPath);
             }
         }
-    } catch (const std::exception& e) {
-        log::error("Error reading memes folder: {}", e.what());
     }
     
-    return memes;
-}
-
-MemeAsset getRandomMeme(const std::vector<MemeAsset>& memes) {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    
-    if (memes.empty()) return MemeAsset{};
-    
-    std::uniform_int_distribution<> dis(0, memes.size() - 1);
-    return memes[dis(gen)];
+    SoundBank::get()->arm(sounds, settings.soundVolume);
 }
 
 class $modify(PlayerObject) {
     struct Fields {
         float soundStopTime = 0.0f;
-        CCSprite* currentDeathImage = nullptr;
         std::string currentSoundPath;
+        int deathSerial = 0;
     };
 
     void playerDestroyed(bool p0) {
+        ScopedTrace trace(TracePhase::Death);
         stopSound();
         PlayerObject::playerDestroyed(p0);
         
-        auto* mod = Mod::get();
-        if (!mod || !mod->getSettingValue<bool>("enabled")) return;
+        auto& settings = Settings::get();
+        if (!settings.enabled) return;
 
         auto* playLayer = PlayLayer::get();
         if (!playLayer) return;
@@ -137,46 +99,39 @@ class $modify(PlayerObject) {
         }
 
         // Check if we're in Globed multiplayer and this is not the local player
-        if (auto* globedMod = Loader::get()->getLoadedMod("geode.globed")) {
+        if (settings.globedLoaded) {
             // For Globed, we can check if this player is not the main player
             if (this != playLayer->m_player1) {
                 return; // Skip death effects for other players in multiplayer
             }
         }
 
-        if (!mod->getSettingValue<bool>("show-in-practice") && playLayer->m_isPracticeMode) return;
+        if (!settings.showInPractice && playLayer->m_isPracticeMode) return;
+        DeathBudget budget(settings.deathFrameBudget);
 
-        if (mod->getSettingValue<bool>("meme-mode")) {
-            auto memesPath = mod->getResourcesDir() / "memes";
-            auto memes = getMemeAssets(memesPath);
-            
-            if (memes.empty()) {
-                log::error("No meme assets found in: {}", memesPath.string());
+        if (settings.memeMode) {
+            auto meme = DeathQueue::get().pop(DeathSource::Memes);
+            if (!meme) {
+                log::error("No meme assets found");
                 return;
             }
             
-            auto meme = getRandomMeme(memes);
-            if (meme.imagePath.empty()) {
-                log::error("Failed to get random meme");
-                return;
-            }
-            
-            if (!meme.soundPath.empty()) {
-                playSound(meme.soundPath);
+            if (!meme->soundPath.empty()) {
+                playSound(meme->soundPath);
             }
             
-            displayImage(meme.imagePath);
+            displayImage(meme->imagePath, meme->frame);
             return;
         }
         
-        if (mod->getSettingValue<bool>("use-custom-sound")) {
-            auto soundPath = mod->getSettingValue<std::string>("custom-sound-path");
+        if (settings.useCustomSound) {
+            auto soundPath = settings.customSoundPath;
             if (!soundPath.empty()) {
                 playSound(soundPath);
             }
         }
         
-        int minPercentage = mod->getSettingValue<int>("min-percentage");
+        int minPercentage = settings.minPercentage;
         int currentPercentage = playLayer->getCurrentPercentInt();
         
         if (minPercentage > 0 && currentPercentage < minPercentage) {
@@ -186,33 +141,38 @@ class $modify(PlayerObject) {
         }
 
         std::filesystem::path imagePath;
+        CCSpriteFrame* frame = nullptr;
         
-        if (mod->getSettingValue<bool>("use-custom-image")) {
-            if (mod->getSettingValue<bool>("use-folder")) {
-                auto folderPath = mod->getSettingValue<std::string>("custom-folder-path");
-                if (folderPath.empty()) {
+        if (settings.useCustomImage) {
+            if (settings.useFolder) {
+                auto folderPath = settings.customFolderPath;
+                if (settings.folderRoots.empty()) {
                     log::error("Custom folder enabled but no path specified");
                     return;
                 }
                 
-                auto images = getImagesFromFolder(folderPath);
-                if (images.empty()) {
+                auto picked = DeathQueue::get().pop(DeathSource::Folder);
+                if (picked) {
+                    imagePath = picked->imagePath;
+                    frame = picked->frame;
+                    log::info("Using random image from folder: {}", imagePath.string());
+                    
+                    if (settings.useImageSpecificSounds && 
+                        !settings.useCustomSound) {
+                        if (!picked->soundPath.empty()) {
+                            playSound(picked->soundPath);
+                        }
+                    }
+                } else if (!FolderIndex::get().snapshot()) {
+                    // The first scan of a big folder can outlast the first few deaths
+                    imagePath = settings.defaultImagePath;
+                    log::info("Folder is still being indexed, using the default image");
+                } else {
                     log::error("No PNG images found in folder: {}", folderPath);
                     return;
                 }
-                
-                imagePath = getRandomImage(images);
-                log::info("Using random image from folder: {}", imagePath.string());
-                
-                if (mod->getSettingValue<bool>("use-image-specific-sounds") && 
-                    !mod->getSettingValue<bool>("use-custom-sound")) {
-                    auto soundPath = findMatchingSoundFile(imagePath);
-                    if (!soundPath.empty()) {
-                        playSound(soundPath);
-                    }
-                }
             } else {
-                auto customPath = mod->getSettingValue<std::string>("custom-image-path");
+                auto customPath = settings.customImagePath;
                 if (customPath.empty()) {
                     log::error("Custom image enabled but no path specified");
                     return;
@@ -220,151 +180,173 @@ class $modify(PlayerObject) {
                 imagePath = customPath;
                 log::info("Using custom image from: {}", imagePath.string());
                 
-                if (mod->getSettingValue<bool>("use-image-specific-sounds") && 
-                    !mod->getSettingValue<bool>("use-custom-sound")) {
-                    auto soundPath = findMatchingSoundFile(imagePath);
-                    if (!soundPath.empty()) {
-                        playSound(soundPath);
+                if (settings.useImageSpecificSounds && 
+                    !settings.useCustomSound) {
+                    if (!settings.customImageSoundPath.empty()) {
+                        playSound(settings.customImageSoundPath);
                     }
                 }
             }
         } else {
-            imagePath = mod->getResourcesDir() / "death.png";
+            imagePath = settings.defaultImagePath;
             log::info("Using default image from: {}", imagePath.string());
             
-            if (!mod->getSettingValue<bool>("use-custom-sound")) {
-                auto soundPath = mod->getResourcesDir() / "death.ogg";
+            if (!settings.useCustomSound) {
+                auto soundPath = settings.defaultSoundPath;
                 playSound(soundPath);
             }
         }
         
-        displayImage(imagePath);
+        displayImage(imagePath, frame);
     }
     
-    void displayImage(const std::filesystem::path& imagePath) {
-        auto* director = CCDirector::sharedDirector();
-        CCSize winSize = director->getWinSize();
+    // Shows `frame` straight away when the image is in the ImageAtlas, otherwise loads it
+    void displayImage(const std::filesystem::path& imagePath, CCSpriteFrame* frame = nullptr) {
+        ScopedTrace trace(TracePhase::Display);
+        auto* playLayer = PlayLayer::get();
+        if (!playLayer) return;
         
-        auto fileResult = geode::utils::file::readBinary(imagePath.string());
-        if (!fileResult.isOk()) {
-            log::error("Failed to read file data: {}", fileResult.unwrapErr());
-            return;
+        auto* animator = DeathAnimator::get(playLayer);
+        if (!animator) return;
+        if (animator->playing()) {
+            switch (Settings::get().deathOverlap) {
+                case DeathOverlap::Ignore:
+                    return;
+                case DeathOverlap::Queue: {
+                    Ref<PlayerObject> self = this;
+                    Ref<CCSpriteFrame> queuedFrame = frame;
+                    animator->enqueue([this, self, imagePath, queuedFrame] {
+                        displayImage(imagePath, queuedFrame);
+                    });
+                    return;
+                }
+                case DeathOverlap::Restart:
+                    break;
+            }
         }
         
-        auto& fileData = fileResult.unwrap();
-        log::info("Read {} bytes of image data", fileData.size());
-        
-        auto* image = new CCImage();
-        if (!image->initWithImageData(
-            static_cast<void*>(const_cast<uint8_t*>(fileData.data())),
-            static_cast<int>(fileData.size())
-        )) {
-            log::error("Failed to create image from data");
-            image->release();
+        int serial = ++m_fields->deathSerial;
+        playLayer->removeChildByID("death-image-placeholder");
+        
+        // Keep ourselves and the level alive until the image arrives, and drop it
+        // if we died again (or left the level) in the meantime
+        Ref<PlayerObject> self = this;
+        Ref<PlayLayer> layer = playLayer;
+        
+        auto* budget = DeathBudget::current();
+        if (budget) budget->setImage(imagePath);
+        if (budget && budget->spent()) {
+            // Out of time already (usually a slow sound), so the image waits a frame
+            DeathBudget::noteDeferred();
+            Ref<CCSpriteFrame> deferredFrame = frame;
+            Loader::get()->queueInMainThread([this, self, layer, serial, imagePath, deferredFrame] {
+                if (m_fields->deathSerial != serial || PlayLayer::get() != layer) return;
+                displayImage(imagePath, deferredFrame);
+            });
             return;
         }
         
-        log::info("Image dimensions: {} x {}", image->getWidth(), image->getHeight());
-        
-        auto* texture = new CCTexture2D();
-        if (!texture->initWithImage(image)) {
-            log::error("Failed to create texture from image");
-            image->release();
-            texture->release();
+        auto* deathImage = animator->image();
+        if (frame) {
+            deathImage->stopActionByTag(AnimationAction::TAG);
+            deathImage->setDisplayFrame(frame);
+            showDeathImage(animator, imagePath);
             return;
         }
         
-        image->release();
+        auto handle = AsyncLoader::get()->load(imagePath, deathImageTarget(imagePath));
+        if (handle->ready()) {
+            setSpriteImage(deathImage, *handle, Settings::get().deathDuration);
+            showDeathImage(animator, imagePath);
+            return;
+        }
         
-        auto deathImage = CCSprite::createWithTexture(texture);
-        texture->release();
+        // Stand in with the thumbnail until the full image is up; prewarming reads it
+        // from thumbnails.cdit for images not seen this session. The default death
+        // scales in with absolute scales, so it always waits for the real thing.
+        bool preview = false;
+        if (imagePath != Settings::get().defaultImagePath) {
+            if (auto thumbnail = ThumbnailStore::get().find(imagePath)) {
+                if (auto* texture = createTexture(*thumbnail)) {
+                    deathImage->stopActionByTag(AnimationAction::TAG);
+                    deathImage->setTexture(texture);
+                    deathImage->setTextureRect(CCRect(CCPointZero, texture->getContentSize()));
+                    texture->release();
+                    preview = true;
+                }
+            }
+        }
         
-        if (!deathImage) {
-            log::error("Failed to create sprite from texture");
-            return;
+        if (preview) {
+            DeathBudget::notePreview();
+            showDeathImage(animator, imagePath);
+        } else if (Settings::get().loadingPlaceholder) {
+            auto* placeholder = CCLayerColor::create(ccc4(0, 0, 0, 120));
+            placeholder->setID("death-image-placeholder");
+            playLayer->addChild(placeholder, 1023);
         }
         
+        Ref<DeathAnimator> animatorRef = animator;
+        handle->then([this, self, layer, animatorRef, serial, imagePath, handle, preview](CCTexture2D* texture) {
+            if (m_fields->deathSerial != serial || PlayLayer::get() != layer) return;
+            
+            layer->removeChildByID("death-image-placeholder");
+            if (!texture) return;
+            if (preview) {
+                // The thumbnail may have finished its effect already
+                if (animatorRef->playing()) swapInImage(animatorRef, *handle);
+            } else {
+                setSpriteImage(animatorRef->image(), *handle, Settings::get().deathDuration);
+                showDeathImage(animatorRef, imagePath);
+            }
+        });
+    }
+    
+    // Replaces a thumbnail with the full image, drawn at the same size and
+    // carrying on with the thumbnail's effect
+    void swapInImage(DeathAnimator* animator, const LoadHandle& handle) {
+        auto* sprite = animator->image();
+        float width = sprite->getContentSize().width;
+        auto blend = sprite->getBlendFunc();
+        setSpriteImage(sprite, handle, Settings::get().deathDuration);
+        sprite->setBlendFunc(blend);
+        float factor = width / sprite->getContentSize().width;
+        sprite->setScale(sprite->getScale() * factor);
+        animator->rescale(factor);
+    }
+    
+    // Starts the death effect on the animator's image, which the caller has
+    // just put the death's image on
+    void showDeathImage(DeathAnimator* animator, const std::filesystem::path& imagePath) {
+        ScopedTrace trace(TracePhase::Sprite);
+        auto* director = CCDirector::sharedDirector();
+        CCSize winSize = director->getWinSize();
+        
+        auto* deathImage = animator->image();
         CCSize size = deathImage->getContentSize();
+        if (size.width <= 0 || size.height <= 0) {
+            log::error("Death image has no size");
+            return;
+        }
         log::info("Sprite size: {} x {}", static_cast<int>(size.width), static_cast<int>(size.height));
         
         float scaleX = winSize.width / size.width;
         float scaleY = winSize.height / size.height;
         float scale = std::max(scaleX, scaleY);
         
-        deathImage->setScale(scale);
-            deathImage->setAnchorPoint(ccp(0.5f, 0.5f));
-            deathImage->setPosition(ccp(winSize.width / 2, winSize.height / 2));
-        
         ccBlendFunc blend;
         blend.src = GL_SRC_ALPHA;
         blend.dst = GL_ONE_MINUS_SRC_ALPHA;
         deathImage->setBlendFunc(blend);
         
-        deathImage->setID("death-image");
+        auto& settings = Settings::get();
+        bool isDefaultDeath = (imagePath == settings.defaultImagePath);
+        animator->play(DeathEffects::get().find(isDefaultDeath ? "jumpscare" : "fade"), scale);
         
-        auto* playLayer = PlayLayer::get();
-        if (playLayer) {
-            playLayer->addChild(deathImage, 1024);
-            
-            float duration = Mod::get()->getSettingValue<float>("death-duration");
-            
-            bool isDefaultDeath = (imagePath == Mod::get()->getResourcesDir() / "death.png");
-            
-            if (isDefaultDeath) {
-                auto* blackOverlay = CCLayerColor::create(ccc4(0, 0, 0, 255));
-                blackOverlay->setID("black-overlay");
-                playLayer->addChild(blackOverlay, 1023);
-                
-                deathImage->setScale(scale * 0.1f);
-                deathImage->setOpacity(0);
-                blackOverlay->setOpacity(0);
-                
-                auto stutterDelay = 0.05f;
-                auto numStutters = 3;
-                
-                auto scaleUp = CCScaleTo::create(0.1f, scale * 1.2f);
-                auto fadeIn = CCFadeIn::create(0.1f);
-                auto scaleNormal = CCScaleTo::create(0.05f, scale);
-                
-                auto* stutterSeq = CCArray::create();
-                for(int i = 0; i < numStutters; i++) {
-                    stutterSeq->addObject(CCFadeTo::create(0.05f, 255));
-                    stutterSeq->addObject(CCFadeTo::create(0.05f, 0));
-                }
-                
-                auto delay = CCDelayTime::create(duration - 0.35f - (stutterDelay * numStutters * 2));
-                auto fadeOut = CCFadeOut::create(0.2f);
-                
-                blackOverlay->runAction(CCSequence::create(
-                    CCDelayTime::create(0.15f),
-                    CCSequence::create(stutterSeq),
-                    CCFadeOut::create(0.1f),
-                    nullptr
-                ));
-                
-                deathImage->runAction(CCSpawn::create(scaleUp, fadeIn, nullptr));
-            deathImage->runAction(CCSequence::create(
-                    CCDelayTime::create(0.1f),
-                    scaleNormal,
-                    delay,
-                    fadeOut,
-                nullptr
-            ));
-                
-                auto jumpscareSound = Mod::get()->getResourcesDir() / "jumpsc.mp3";
-                if (std::filesystem::exists(jumpscareSound)) {
-                    playSound(jumpscareSound);
-                }
-            } else {
-                deathImage->setOpacity(255);
-                auto fadeOut = CCFadeOut::create(0.2f);
-                
-                auto fadeSequence = CCSequence::create(
-                    CCDelayTime::create(duration - 0.2f),
-                    fadeOut,
-                    nullptr
-                );
-                deathImage->runAction(fadeSequence);
+        if (isDefaultDeath) {
+            auto jumpscareSound = settings.jumpscareSoundPath;
+            if (std::filesystem::exists(jumpscareSound)) {
+                playSound(jumpscareSound);
             }
         }
     }
@@ -376,71 +358,39 @@ class $modify(PlayerObject) {
 
     void playSound(const std::filesystem::path& soundPath) {
         if (soundPath.empty()) return;
+        ScopedTrace trace(TracePhase::Sound);
         
         auto* engine = FMODAudioEngine::sharedEngine();
         if (!engine) return;
 
-        auto* mod = Mod::get();
-        if (!mod) return;
-
         m_fields->currentSoundPath = soundPath.string();
-        
-        FMOD::Sound* sound = nullptr;
-        FMOD::Channel* channel = nullptr;
-        
-        if (engine->m_system->createStream(
-            soundPath.string().c_str(),
-            FMOD_DEFAULT,
-            nullptr,
-            &sound
-        ) == FMOD_OK) {
-            if (sound && engine->m_system->playSound(
-                sound,
-                nullptr,
-                false,
-                &channel
-            ) == FMOD_OK) {
-                if (channel) {
-                    float volume = mod->getSettingValue<float>("sound-volume");
-                    channel->setVolume(volume);
-                }
-            }
-        }
+        SoundBank::get()->play(soundPath, Settings::get().soundVolume);
     }
 
     void stopSound() {
         if (!m_fields->currentSoundPath.empty()) {
-            auto* engine = FMODAudioEngine::sharedEngine();
-            if (engine) {
-                engine->stopAllEffects();
-            }
+            SoundBank::get()->stopAll();
             m_fields->currentSoundPath.clear();
         }
     }
-
-    void cleanupDeath() {
-        stopSound();
-        if (m_fields->currentDeathImage) {
-            m_fields->currentDeathImage->removeFromParent();
-            m_fields->currentDeathImage = nullptr;
-        }
-    }
 };
 
 class $modify(PlayLayer) {
     struct Fields {
-        CCSprite* miniImage = nullptr;
+        PiPOverlay* pip = nullptr;
         bool isDragging = false;
         CCPoint dragOffset;
-        CCSprite* levelPreview = nullptr;
+        PreviewSnapshot* levelPreview = nullptr;
         CCLayerColor* previewBg = nullptr;
+        CCLabelBMFont* instructions = nullptr;
+        bool previewShown = false;
+        PerfHud* perfHud = nullptr;
     };
 
     bool init(GJGameLevel* level, bool useReplay, bool dontCreateObjects) {
         if (!PlayLayer::init(level, useReplay, dontCreateObjects)) return false;
         
-        auto* mod = Mod::get();
-        if (!mod || !mod->getSettingValue<bool>("enabled")) return true;
+        if (!Settings::get().enabled) return true;
         
         auto dispatcher = CCDirector::sharedDirector()->getKeyboardDispatcher();
         if (dispatcher) {
@@ -448,6 +398,9 @@ class $modify(PlayLayer) {
         }
         
         setupPiP();
+        // Made up front so the first death doesn't build the overlay nodes
+        DeathAnimator::get(this);
+        prewarmNextDeath();
         return true;
     }
 
@@ -456,80 +409,83 @@ class $modify(PlayLayer) {
         
         if (key == cocos2d::KEY_O) {
             showPositioningPreview();
+        } else if (key == cocos2d::KEY_F3 && Settings::get().perfHud) {
+            togglePerfHud();
         }
     }
 
+    void togglePerfHud() {
+        if (m_fields->perfHud) {
+            m_fields->perfHud->removeFromParent();
+            m_fields->perfHud = nullptr;
+            return;
+        }
+        m_fields->perfHud = PerfHud::create();
+        this->addChild(m_fields->perfHud, 2000);
+    }
+
     void showPositioningPreview() {
-        auto* director = CCDirector::sharedDirector();
-        auto winSize = director->getWinSize();
+        if (m_fields->previewShown) {
+            hidePositioningPreview();
+            return;
+        }
+        auto winSize = CCDirector::sharedDirector()->getWinSize();
 
-        if (!m_fields->previewBg) {
+        // Built once per level; closing the preview only hides it
+        if (!m_fields->levelPreview) {
             m_fields->previewBg = CCLayerColor::create(ccc4(0, 0, 0, 180));
             m_fields->previewBg->setContentSize(winSize);
             this->addChild(m_fields->previewBg, 1000);
-        }
-
-        if (!m_fields->levelPreview) {
-            float previewWidth = winSize.width * 0.3f;
-            float previewHeight = previewWidth * (winSize.height / winSize.width);
-
-            auto renderTexture = CCRenderTexture::create(winSize.width, winSize.height);
-            renderTexture->begin();
-            
-            auto gameLayer = this->getChildByID("game-layer");
-            if (gameLayer) {
-                gameLayer->visit();
-            }
-            
-            renderTexture->end();
 
-            m_fields->levelPreview = CCSprite::createWithTexture(renderTexture->getSprite()->getTexture());
-            m_fields->levelPreview->setScale(previewWidth / winSize.width);
+            m_fields->levelPreview = PreviewSnapshot::create(0.3f);
             m_fields->levelPreview->setPosition(ccp(winSize.width / 2, winSize.height / 2));
             m_fields->levelPreview->setOpacity(200);
             this->addChild(m_fields->levelPreview, 1001);
 
-            auto instructions = CCLabelBMFont::create(
+            m_fields->instructions = CCLabelBMFont::create(
                 "Click and drag to position the PiP window\nPress O again to save",
                 "bigFont.fnt"
             );
-            instructions->setScale(0.5f);
-            instructions->setPosition(ccp(winSize.width / 2, winSize.height - 30));
-            instructions->setZOrder(1002);
-            this->addChild(instructions, 1002);
+            m_fields->instructions->setID("instructions");
+            m_fields->instructions->setScale(0.5f);
+            m_fields->instructions->setPosition(ccp(winSize.width / 2, winSize.height - 30));
+            this->addChild(m_fields->instructions, 1002);
+        }
 
-            this->setTouchEnabled(true);
-            this->setTouchMode(kCCTouchesOneByOne);
-            this->setTouchPriority(-1000);
+        auto& settings = Settings::get();
+        m_fields->levelPreview->setRefreshRate(settings.previewLiveRefresh ? settings.previewRefreshRate : 0);
+        m_fields->levelPreview->capture(this->getChildByID("game-layer"));
+        setPreviewVisible(true);
 
-            this->m_isPaused = true;
-            CCDirector::sharedDirector()->pause();
-        } else {
-            hidePositioningPreview();
-        }
+        this->setTouchEnabled(true);
+        this->setTouchMode(kCCTouchesOneByOne);
+        this->setTouchPriority(-1000);
+
+        this->m_isPaused = true;
+        CCDirector::sharedDirector()->pause();
     }
 
     void hidePositioningPreview() {
-        if (m_fields->previewBg) {
-            m_fields->previewBg->removeFromParent();
-            m_fields->previewBg = nullptr;
-        }
-        if (m_fields->levelPreview) {
-            m_fields->levelPreview->removeFromParent();
-            m_fields->levelPreview = nullptr;
-        }
-
-        this->removeChildByID("instructions");
+        if (!m_fields->previewShown) return;
+        setPreviewVisible(false);
+        PiPPositionWriter::get()->flush();
 
         this->m_isPaused = false;
         CCDirector::sharedDirector()->resume();
     }
 
+    void setPreviewVisible(bool visible) {
+        m_fields->previewShown = visible;
+        m_fields->previewBg->setVisible(visible);
+        m_fields->levelPreview->setVisible(visible);
+        m_fields->instructions->setVisible(visible);
+    }
+
     virtual bool ccTouchBegan(CCTouch* touch, CCEvent*) override {
-        if (!m_fields->miniImage) return false;
+        if (!m_fields->pip || !m_fields->pip->isVisible()) return false;
         
         auto touchLocation = touch->getLocation();
-        auto bounds = m_fields->miniImage->boundingBox();
+        auto bounds = m_fields->pip->boundingBox();
         
         bounds.origin.x -= 10;
         bounds.origin.y -= 10;
@@ -538,7 +494,7 @@ class $modify(PlayLayer) {
         
         if (bounds.containsPoint(touchLocation)) {
             m_fields->isDragging = true;
-            m_fields->dragOffset = ccpSub(m_fields->miniImage->getPosition(), touchLocation);
+            m_fields->dragOffset = ccpSub(m_fields->pip->getPosition(), touchLocation);
             return true;
         }
         
@@ -546,141 +502,47 @@ class $modify(PlayLayer) {
     }
     
     virtual void ccTouchMoved(CCTouch* touch, CCEvent*) override {
-        if (!m_fields->isDragging || !m_fields->miniImage) return;
+        if (!m_fields->isDragging || !m_fields->pip) return;
         
         auto touchLocation = touch->getLocation();
-        auto newPos = ccpAdd(touchLocation, m_fields->dragOffset);
-        
-        auto* director = CCDirector::sharedDirector();
-        CCSize winSize = director->getWinSize();
-        CCSize size = m_fields->miniImage->getContentSize();
-        float scale = m_fields->miniImage->getScale();
-        float padding = static_cast<float>(Mod::get()->getSettingValue<int>("pip-padding"));
-        
-        float halfWidth = (size.width * scale) / 2;
-        float halfHeight = (size.height * scale) / 2;
-        
-        newPos.x = std::max(halfWidth + padding, 
-                   std::min(newPos.x, winSize.width - halfWidth - padding));
-        newPos.y = std::max(halfHeight + padding, 
-                   std::min(newPos.y, winSize.height - halfHeight - padding));
-        
-        m_fields->miniImage->setPosition(newPos);
-        
-        if (auto* bg = this->getChildByTag(999)) {
-            bg->setPosition(newPos.x - (halfWidth * 2 + 10)/2, newPos.y - (halfHeight * 2 + 10)/2);
-        }
+        auto newPos = m_fields->pip->clampPosition(ccpAdd(touchLocation, m_fields->dragOffset));
+        m_fields->pip->setPosition(newPos);
         
-        auto* mod = Mod::get();
-        if (mod) {
-            float normalizedX = newPos.x / winSize.width;
-            float normalizedY = newPos.y / winSize.height;
-            
-            mod->setSettingValue<float>("pip-position-x", normalizedX);
-            mod->setSettingValue<float>("pip-position-y", normalizedY);
-            mod->setSettingValue<bool>("has-custom-position", true);
-        }
+        CCSize winSize = CCDirector::sharedDirector()->getWinSize();
+        PiPPositionWriter::get()->stage(newPos.x / winSize.width, newPos.y / winSize.height);
     }
     
     virtual void ccTouchEnded(CCTouch*, CCEvent*) override {
         m_fields->isDragging = false;
+        PiPPositionWriter::get()->flush();
     }
     
     virtual void ccTouchCancelled(CCTouch*, CCEvent*) override {
         m_fields->isDragging = false;
+        PiPPositionWriter::get()->flush();
     }
 
     void setupPiP() {
-        auto* mod = Mod::get();
-        if (!mod || !mod->getSettingValue<bool>("enabled") || !mod->getSettingValue<bool>("pip-mode")) return;
-
-        std::filesystem::path imagePath;
-        if (mod->getSettingValue<bool>("pip-use-custom-image")) {
-            imagePath = mod->getSettingValue<std::string>("pip-image-path");
-        }
-        if (imagePath.empty()) {
-            imagePath = mod->getResourcesDir() / "livereact.png";
-        }
-
-        auto fileResult = geode::utils::file::readBinary(imagePath.string());
-        if (!fileResult.isOk()) return;
-
-        auto& fileData = fileResult.unwrap();
-        auto* image = new CCImage();
-        if (!image->initWithImageData(
-            static_cast<void*>(const_cast<uint8_t*>(fileData.data())),
-            static_cast<int>(fileData.size())
-        )) {
-            image->release();
-            return;
-        }
-
-        auto* texture = new CCTexture2D();
-        if (!texture->initWithImage(image)) {
-            image->release();
-            texture->release();
-            return;
-        }
-
-        m_fields->miniImage = CCSprite::createWithTexture(texture);
-        texture->release();
-        image->release();
-
-        if (!m_fields->miniImage) return;
-
-        float pipSize = mod->getSettingValue<int>("pip-size") / 100.0f;
-        float sizeMultiplier = mod->getSettingValue<float>("pip-size-multiplier");
-        CCSize originalSize = m_fields->miniImage->getContentSize();
-        float scale = (CCDirector::sharedDirector()->getWinSize().width * pipSize * sizeMultiplier) / originalSize.width;
-        m_fields->miniImage->setScale(scale);
-
-        CCSize scaledSize = CCSizeMake(originalSize.width * scale, originalSize.height * scale);
-        auto* bg = CCLayerColor::create(ccc4(0, 0, 0, 100), scaledSize.width, scaledSize.height);
-        this->addChild(bg);
-        this->addChild(m_fields->miniImage);
-
-        float padding = static_cast<float>(mod->getSettingValue<int>("pip-padding"));
-        CCSize winSize = CCDirector::sharedDirector()->getWinSize();
-        CCPoint basePos;
-        
-        float offsetX = static_cast<float>(mod->getSettingValue<int>("pip-offset-x"));
-        float offsetY = static_cast<float>(mod->getSettingValue<int>("pip-offset-y"));
-        
-        switch (mod->getSettingValue<int>("pip-position")) {
-            case 0:
-                basePos = ccp(winSize.width - scaledSize.width/2 - padding + offsetX, 
-                             winSize.height - scaledSize.height/2 - padding - offsetY);
-                break;
-            case 1:
-                basePos = ccp(scaledSize.width/2 + padding + offsetX, 
-                             winSize.height - scaledSize.height/2 - padding - offsetY);
-                break;
-            case 2:
-                basePos = ccp(winSize.width - scaledSize.width/2 - padding + offsetX, 
-                             scaledSize.height/2 + padding + offsetY);
-                break;
-            case 3:
-                basePos = ccp(scaledSize.width/2 + padding + offsetX, 
-                             scaledSize.height/2 + padding + offsetY);
-                break;
-        }
-
-        basePos.x = std::max(scaledSize.width/2 + padding, 
-                     std::min(basePos.x, winSize.width - scaledSize.width/2 - padding));
-        basePos.y = std::max(scaledSize.height/2 + padding, 
-                     std::min(basePos.y, winSize.height - scaledSize.height/2 - padding));
-
-        m_fields->miniImage->setPosition(basePos);
-        bg->setPosition(basePos.x - scaledSize.width/2, basePos.y - scaledSize.height/2);
-    }
-
-    void onEnter() {
-        PlayLayer::onEnter();
-        setupPiP();
+        if (m_fields->pip) return;
+        ScopedTrace trace(TracePhase::PiP);
+        
+        // Stays for the lifetime of the level and hides itself while PiP mode is off
+        m_fields->pip = PiPOverlay::create();
+        this->addChild(m_fields->pip);
     }
 
     void resetLevel() {
         PlayLayer::resetLevel();
-        setupPiP();
+        prewarmNextDeath();
+        TraceReport::get().collect();
+    }
+
+    void onQuit() {
+        hidePositioningPreview();
+        TraceReport::get().report();
+        DeathBudget::report();
+        SoundBank::get()->disarm();
+        PiPPositionWriter::get()->flush();
+        PlayLayer::onQuit();
     }
 };
@@ -0,0 +1,184 @@
+// Converts images into the mod's baked .cdib format (see src/BakedImage.hpp),
+// written next to each source. Folders are listed with the mod's own scanner,
+// so they pick up the same images it does: subfolders included unless
+// --no-subfolders is given (the mod's Include Subfolders setting), and
+// extensions in any case. Run it on resources/, resources/memes and your
+// custom folders:
+//
+//   cdi-bake [--format rgba8888|rgb565|rgba4444] [--force] [--no-subfolders] <image-or-folder>...
+//
+// Images whose baked file is already newer than them are skipped unless
+// --force is given. APNGs and GIFs are skipped too: the mod streams their
+// frames from the original file.
+
+#include "AnimatedImage.hpp"
+#include "AssetScan.hpp"
+#include "BakedImage.hpp"
+#include "HostDecode.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace {
+    struct Options {
+        BakedFormat format = BakedFormat::RGBA8888;
+        bool force = false;
+        bool subfolders = true;
+    };
+
+    const char* formatName(BakedFormat format) {
+        switch (format) {
+            case BakedFormat::RGB565: return "rgb565";
+            case BakedFormat::RGBA4444: return "rgba4444";
+            default: return "rgba8888";
+        }
+    }
+
+    bool isOpaque(const DecodedImage& image) {
+        for (size_t i = 3; i < image.pixels.size(); i += 4) {
+            if (image.pixels[i] != 255) return false;
+        }
+        return true;
+    }
+
+    bool isFresh(const std::filesystem::path& source, const std::filesystem::path& baked, uintmax_t sourceSize) {
+        std::error_code ec;
+        auto bakedTime = std::filesystem::last_write_time(baked, ec);
+        if (ec || bakedTime < std::filesystem::last_write_time(source, ec) || ec) return false;
+
+        std::ifstream file(baked, std::ios::binary);
+        BakedImageHeader header;
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+        return std::memcmp(header.magic, BAKED_IMAGE_MAGIC, 4) == 0
+            && header.version == BAKED_IMAGE_VERSION
+            && header.sourceSize == sourceSize;
+    }
+
+    // Returns false on errors
+    bool bake(const std::filesystem::path& source, const Options& options) {
+        auto baked = bakedPathFor(source);
+        std::error_code ec;
+        auto sourceSize = std::filesystem::file_size(source, ec);
+        if (ec) {
+            std::fprintf(stderr, "%s: %s\n", source.string().c_str(), ec.message().c_str());
+            return false;
+        }
+        if (!options.force && isFresh(source, baked, sourceSize)) {
+            std::printf("%s: up to date\n", source.string().c_str());
+            return true;
+        }
+
+        std::ifstream file(source, std::ios::binary);
+        std::vector<uint8_t> data(std::istreambuf_iterator<char>(file), {});
+        if (auto animation = openAnimation(data.data(), data.size()); animation && animation->animated()) {
+            std::printf("%s: animated, skipped\n", source.string().c_str());
+            return true;
+        }
+        auto image = decodeHost(data);
+        if (!image) {
+            std::fprintf(stderr, "%s: not an image this tool can decode\n", source.string().c_str());
+            return false;
+        }
+
+        auto format = options.format;
+        if (format == BakedFormat::RGB565 && !isOpaque(*image)) {
+            std::fprintf(stderr, "%s: has transparency, keeping rgba8888 instead of rgb565\n", source.string().c_str());
+            format = BakedFormat::RGBA8888;
+        }
+        auto out = bakeImage(*image, format, sourceSize);
+
+        // Write to a temporary name first so the mod never maps a half-written file
+        auto temporary = baked;
+        temporary += ".tmp";
+        {
+            std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+            if (!output.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()))) {
+                std::fprintf(stderr, "%s: failed to write\n", temporary.string().c_str());
+                return false;
+            }
+        }
+        std::filesystem::rename(temporary, baked, ec);
+        if (ec) {
+            std::fprintf(stderr, "%s: %s\n", baked.string().c_str(), ec.message().c_str());
+            return false;
+        }
+
+        std::printf(
+            "%s: %ux%u %s, %zu KB\n", baked.string().c_str(), image->width, image->height,
+            formatName(format), out.size() / 1024
+        );
+        return true;
+    }
+
+    int usage() {
+        std::fprintf(
+            stderr, "usage: cdi-bake [--format rgba8888|rgb565|rgba4444] [--force] [--no-subfolders] <image-or-folder>...\n"
+        );
+        return 2;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    std::vector<std::filesystem::path> inputs;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--force") {
+            options.force = true;
+        } else if (arg == "--no-subfolders") {
+            options.subfolders = false;
+        } else if (arg == "--format" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "rgba8888") {
+                options.format = BakedFormat::RGBA8888;
+            } else if (name == "rgb565") {
+                options.format = BakedFormat::RGB565;
+            } else if (name == "rgba4444") {
+                options.format = BakedFormat::RGBA4444;
+            } else {
+                return usage();
+            }
+        } else if (arg.starts_with("--")) {
+            return usage();
+        } else {
+            inputs.emplace_back(arg);
+        }
+    }
+    if (inputs.empty()) return usage();
+
+    bool ok = true;
+    std::vector<std::filesystem::path> roots;
+    for (auto& input : inputs) {
+        std::error_code ec;
+        if (std::filesystem::is_directory(input, ec)) {
+            roots.push_back(input);
+        } else {
+            ok = bake(input, options) && ok;
+        }
+    }
+    if (roots.empty()) return ok ? 0 : 1;
+
+    TreeScanOptions scanOptions;
+    scanOptions.recursive = options.subfolders;
+    auto tree = scanAssetTree(roots, scanOptions);
+    for (auto& root : tree.failedRoots) {
+        std::fprintf(stderr, "%s: can't be listed\n", root.string().c_str());
+        ok = false;
+    }
+    for (auto& folder : tree.folders) {
+        std::vector<std::string> stems;
+        for (auto& [stem, slot] : folder.slots) {
+            if (slot.hasImage()) stems.push_back(stem);
+        }
+        std::sort(stems.begin(), stems.end());
+        for (auto& stem : stems) {
+            ok = bake(folder.folder / (stem + folder.slots.at(stem).imageExtension()), options) && ok;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,291 @@
+// Times the mod's Geode-independent asset pipeline: folder and tree scanning
+// and pairing, sound sidecar lookup, random and weighted selection and PNG decoding. Folders of
+// 10 to 100k files are generated in a temporary directory (and removed
+// afterwards); images are synthetic, from 256x256 up to 8K.
+//
+//   cdi-bench [--json results.json] [--filter text] [--max-files N] [--max-pixels N]
+//
+// --json writes every result as JSON for tracking regressions between runs.
+// --filter keeps the benchmarks whose name contains the text; --max-files and
+// --max-pixels skip the bigger cases for a quicker run.
+
+#include "AliasTable.hpp"
+#include "AssetScan.hpp"
+#include "HostDecode.hpp"
+#include "PngDecoder.hpp"
+#include "ShuffleBag.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Result {
+        std::string name;
+        // Files in the folder, or pixels in the image
+        uint64_t param;
+        // Items each run handles, for per-item numbers
+        uint64_t items;
+        double medianMs;
+        double p95Ms;
+        double minMs;
+        size_t runs;
+    };
+
+    struct Options {
+        std::filesystem::path json;
+        std::string filter;
+        uint64_t maxFiles = 100000;
+        uint64_t maxPixels = 7680ull * 4320;
+    };
+
+    // Runs `run` at least 3 times and until roughly half a second has passed,
+    // up to 100 runs
+    Result measure(const std::string& name, uint64_t param, uint64_t items, const std::function<void()>& run) {
+        std::vector<double> samples;
+        double total = 0;
+        while (samples.size() < 3 || (total < 500 && samples.size() < 100)) {
+            auto start = std::chrono::steady_clock::now();
+            run();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            samples.push_back(ms);
+            total += ms;
+        }
+        std::sort(samples.begin(), samples.end());
+
+        Result result;
+        result.name = name;
+        result.param = param;
+        result.items = items;
+        result.medianMs = samples[samples.size() / 2];
+        result.p95Ms = samples[std::min(samples.size() - 1, samples.size() * 95 / 100)];
+        result.minMs = samples.front();
+        result.runs = samples.size();
+        return result;
+    }
+
+    void print(const Result& result) {
+        std::printf(
+            "%-16s %10llu %10.3f %10.3f %10.3f %12.3f %6zu\n",
+            result.name.c_str(), static_cast<unsigned long long>(result.param),
+            result.medianMs, result.p95Ms, result.minMs,
+            result.medianMs * 1000.0 / static_cast<double>(std::max<uint64_t>(result.items, 1)), result.runs
+        );
+    }
+
+    // Appended rather than `prefix + std::to_string(n)`, which sets off a false
+    // -Wrestrict in GCC 12
+    std::string numbered(const char* prefix, uint64_t n) {
+        std::string name = prefix;
+        name += std::to_string(n);
+        return name;
+    }
+
+    // About one in ten stems is a GIF, and the sounds cycle through none, .ogg,
+    // .mp3 and both, with a stray non-asset file every so often
+    std::vector<std::filesystem::path> populate(const std::filesystem::path& folder, uint64_t files) {
+        std::filesystem::create_directories(folder);
+        std::vector<std::filesystem::path> images;
+        uint64_t written = 0;
+        auto touch = [&](const std::filesystem::path& path) {
+            if (written >= files) return false;
+            std::ofstream(path, std::ios::binary);
+            written++;
+            return true;
+        };
+
+        for (uint64_t i = 0; written < files; i++) {
+            auto stem = numbered("death_", i);
+            auto image = folder / (stem + (i % 10 == 9 ? ".gif" : ".png"));
+            if (!touch(image)) break;
+            images.push_back(image);
+            if (i % 4 == 1 || i % 4 == 3) touch(folder / (stem + ".ogg"));
+            if (i % 4 == 2 || i % 4 == 3) touch(folder / (stem + ".mp3"));
+            if (i % 25 == 24) touch(folder / (stem + ".txt"));
+        }
+        return images;
+    }
+
+    // The same files spread over nested folders, 200 to a folder and 10
+    // folders to a parent
+    void populateTree(const std::filesystem::path& root, uint64_t files) {
+        for (uint64_t folder = 0; folder * 200 < files; folder++) {
+            auto dir = root;
+            for (uint64_t parent = folder / 10; parent > 0; parent /= 10) {
+                dir /= numbered("p", parent % 10);
+            }
+            populate(dir / numbered("f", folder), std::min<uint64_t>(200, files - folder * 200));
+        }
+    }
+
+    void writeJson(const std::filesystem::path& path, const std::vector<Result>& results) {
+        std::ofstream out(path, std::ios::trunc);
+        out << "{\n  \"unit\": \"ms\",\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            auto& r = results[i];
+            char line[512];
+            std::snprintf(
+                line, sizeof(line),
+                "    {\"name\": \"%s\", \"param\": %llu, \"items\": %llu, \"median\": %.6f, \"p95\": %.6f, "
+                "\"min\": %.6f, \"runs\": %zu}%s\n",
+                r.name.c_str(), static_cast<unsigned long long>(r.param), static_cast<unsigned long long>(r.items),
+                r.medianMs, r.p95Ms, r.minMs, r.runs, i + 1 < results.size() ? "," : ""
+            );
+            out << line;
+        }
+        out << "  ]\n}\n";
+        if (!out) std::fprintf(stderr, "%s: failed to write\n", path.string().c_str());
+    }
+
+    int usage() {
+        std::fprintf(stderr, "usage: cdi-bench [--json results.json] [--filter text] [--max-files N] [--max-pixels N]\n");
+        return 1;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return usage();
+        if (arg == "--json") {
+            options.json = argv[++i];
+        } else if (arg == "--filter") {
+            options.filter = argv[++i];
+        } else if (arg == "--max-files") {
+            options.maxFiles = std::stoull(argv[++i]);
+        } else if (arg == "--max-pixels") {
+            options.maxPixels = std::stoull(argv[++i]);
+        } else {
+            return usage();
+        }
+    }
+
+    std::vector<Result> results;
+    auto wanted = [&](const std::string& name) {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    };
+    auto record = [&](Result result) {
+        print(result);
+        results.push_back(std::move(result));
+    };
+
+    std::printf(
+        "%-16s %10s %10s %10s %10s %12s %6s\n", "benchmark", "param", "median ms", "p95 ms", "min ms", "us/item", "runs"
+    );
+
+    auto root = std::filesystem::temp_directory_path() / numbered("cdi-bench-", std::random_device {}());
+    for (uint64_t files : { 10ull, 100ull, 1000ull, 10000ull, 100000ull }) {
+        if (files > options.maxFiles) break;
+        auto folder = root / std::to_string(files);
+        auto images = populate(folder, files);
+
+        if (wanted("scan/folder")) {
+            record(measure("scan/folder", files, files, [&] {
+                AssetSlots slots;
+                scanAssetFolder(folder, slots);
+                pairFolderImages(folder, slots);
+            }));
+        }
+        if (wanted("scan/memes")) {
+            record(measure("scan/memes", files, files, [&] {
+                AssetSlots slots;
+                scanAssetFolder(folder, slots);
+                pairMemes(folder, slots);
+            }));
+        }
+        if (wanted("sidecar/find")) {
+            // What picking an image outside the index costs, per image
+            size_t count = std::min<size_t>(images.size(), 1000);
+            record(measure("sidecar/find", files, count, [&] {
+                for (size_t i = 0; i < count; i++) {
+                    findMatchingSoundFile(images[i * images.size() / count]);
+                }
+            }));
+        }
+        if (wanted("select/shuffle")) {
+            // A full round of picks, including the reshuffle that starts it
+            ShuffleBag bag;
+            record(measure("select/shuffle", files, images.size(), [&] {
+                bag.reset(images.size());
+                size_t sink = 0;
+                for (size_t i = 0; i < images.size(); i++) {
+                    sink += bag.next();
+                }
+                volatile size_t keep = sink;
+                (void)keep;
+            }));
+        }
+        if (wanted("select/alias")) {
+            // As many weighted draws as there are images; building the table
+            // happens once per folder change, so it isn't timed
+            std::mt19937 gen(files);
+            std::uniform_real_distribution<double> weight(0.1, 10.0);
+            std::vector<double> weights(images.size());
+            for (auto& w : weights) w = weight(gen);
+            AliasTable table(weights);
+            record(measure("select/alias", files, images.size(), [&] {
+                size_t sink = 0;
+                for (size_t i = 0; i < images.size(); i++) {
+                    sink += table.sample(gen);
+                }
+                volatile size_t keep = sink;
+                (void)keep;
+            }));
+        }
+        if (wanted("scan/tree")) {
+            auto tree = root / (std::to_string(files).append("-tree"));
+            populateTree(tree, files);
+            for (unsigned threads : { 1u, 0u }) {
+                std::string name = threads == 1 ? "scan/tree-1t" : "scan/tree";
+                if (!wanted(name)) continue;
+                TreeScanOptions scanOptions;
+                scanOptions.threads = threads;
+                record(measure(name, files, files, [&] {
+                    for (auto& found : scanAssetTree({ tree }, scanOptions).folders) {
+                        pairFolderImages(found.folder, found.slots);
+                    }
+                }));
+            }
+            std::error_code ec;
+            std::filesystem::remove_all(tree, ec);
+        }
+        std::error_code ec;
+        std::filesystem::remove_all(folder, ec);
+    }
+    std::error_code ec;
+    std::filesystem::remove_all(root, ec);
+
+    struct Size {
+        uint32_t width;
+        uint32_t height;
+    };
+    for (auto [width, height] : {
+        Size { 256, 256 },
+        Size { 1024, 1024 },
+        Size { 2048, 2048 },
+        Size { 3840, 2160 },
+        Size { 7680, 4320 },
+    }) {
+        uint64_t pixels = uint64_t(width) * height;
+        if (pixels > options.maxPixels) break;
+        for (bool alpha : { false, true }) {
+            std::string name = alpha ? "decode/png-rgba" : "decode/png-rgb";
+            if (!wanted(name)) continue;
+            auto data = encodeSyntheticPng(width, height, alpha);
+            record(measure(name, pixels, pixels, [&] {
+                if (!decodePng(data.data(), data.size())) {
+                    std::fprintf(stderr, "%s %ux%u failed to decode\n", name.c_str(), width, height);
+                }
+            }));
+        }
+    }
+
+    if (!options.json.empty()) writeJson(options.json, results);
+    return 0;
+}
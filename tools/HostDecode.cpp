@@ -0,0 +1,182 @@
+#include "HostDecode.hpp"
+#include "PngDecoder.hpp"
+#include <png.h>
+#include <csetjmp>
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+#ifdef CDI_HAVE_JPEG
+#include <jpeglib.h>
+#endif
+
+namespace {
+    struct Reader {
+        const uint8_t* data;
+        size_t size;
+        size_t pos;
+    };
+
+#ifdef CDI_HAVE_JPEG
+    struct JpegError {
+        jpeg_error_mgr manager;
+        jmp_buf jump;
+    };
+#endif
+}
+
+std::optional<DecodedImage> decodeLibpng(const std::vector<uint8_t>& data) {
+    if (data.size() < 8 || png_sig_cmp(data.data(), 0, 8)) return std::nullopt;
+
+    auto png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    auto info = png_create_info_struct(png);
+    DecodedImage image;
+    std::vector<uint8_t> rows;
+    if (setjmp(png_jmpbuf(png))) {
+        png_destroy_read_struct(&png, &info, nullptr);
+        return std::nullopt;
+    }
+
+    Reader reader { data.data(), data.size(), 0 };
+    png_set_read_fn(png, &reader, [](png_structp png, png_bytep out, png_size_t length) {
+        auto* reader = static_cast<Reader*>(png_get_io_ptr(png));
+        if (reader->size - reader->pos < length) png_error(png, "truncated");
+        std::memcpy(out, reader->data + reader->pos, length);
+        reader->pos += length;
+    });
+    png_read_info(png, info);
+
+    auto colorType = png_get_color_type(png, info);
+    auto bitDepth = png_get_bit_depth(png, info);
+    if (colorType == PNG_COLOR_TYPE_PALETTE) png_set_palette_to_rgb(png);
+    if (colorType == PNG_COLOR_TYPE_GRAY && bitDepth < 8) png_set_expand_gray_1_2_4_to_8(png);
+    if (png_get_valid(png, info, PNG_INFO_tRNS)) png_set_tRNS_to_alpha(png);
+    if (bitDepth == 16) png_set_strip_16(png);
+    if (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA) png_set_gray_to_rgb(png);
+    png_read_update_info(png, info);
+
+    image.width = png_get_image_width(png, info);
+    image.height = png_get_image_height(png, info);
+    size_t rowBytes = png_get_rowbytes(png, info);
+    bool hasAlpha = png_get_channels(png, info) == 4;
+
+    rows.resize(rowBytes * image.height);
+    std::vector<png_bytep> pointers(image.height);
+    for (uint32_t y = 0; y < image.height; y++) {
+        pointers[y] = rows.data() + y * rowBytes;
+    }
+    png_read_image(png, pointers.data());
+    png_read_end(png, nullptr);
+    png_destroy_read_struct(&png, &info, nullptr);
+
+    size_t pixels = size_t(image.width) * image.height;
+    image.pixels.resize(pixels * 4);
+    auto* dst = image.pixels.data();
+    if (hasAlpha) {
+        for (size_t i = 0; i < pixels; i++) {
+            unsigned alpha = rows[i * 4 + 3];
+            dst[i * 4 + 0] = static_cast<uint8_t>((rows[i * 4 + 0] * (alpha + 1)) >> 8);
+            dst[i * 4 + 1] = static_cast<uint8_t>((rows[i * 4 + 1] * (alpha + 1)) >> 8);
+            dst[i * 4 + 2] = static_cast<uint8_t>((rows[i * 4 + 2] * (alpha + 1)) >> 8);
+            dst[i * 4 + 3] = static_cast<uint8_t>(alpha);
+        }
+    } else {
+        for (size_t i = 0; i < pixels; i++) {
+            dst[i * 4 + 0] = rows[i * 3 + 0];
+            dst[i * 4 + 1] = rows[i * 3 + 1];
+            dst[i * 4 + 2] = rows[i * 3 + 2];
+            dst[i * 4 + 3] = 255;
+        }
+    }
+    return image;
+}
+
+#ifdef CDI_HAVE_JPEG
+std::optional<DecodedImage> decodeLibjpeg(const std::vector<uint8_t>& data) {
+    if (data.size() < 3 || data[0] != 0xff || data[1] != 0xd8 || data[2] != 0xff) return std::nullopt;
+
+    jpeg_decompress_struct jpeg;
+    JpegError error;
+    jpeg.err = jpeg_std_error(&error.manager);
+    error.manager.error_exit = [](j_common_ptr jpeg) {
+        longjmp(reinterpret_cast<JpegError*>(jpeg->err)->jump, 1);
+    };
+    DecodedImage image;
+    std::vector<uint8_t> row;
+    if (setjmp(error.jump)) {
+        jpeg_destroy_decompress(&jpeg);
+        return std::nullopt;
+    }
+
+    jpeg_create_decompress(&jpeg);
+    jpeg_mem_src(&jpeg, data.data(), static_cast<unsigned long>(data.size()));
+    jpeg_read_header(&jpeg, TRUE);
+    jpeg.out_color_space = JCS_RGB;
+    jpeg_start_decompress(&jpeg);
+
+    image.width = jpeg.output_width;
+    image.height = jpeg.output_height;
+    image.pixels.resize(size_t(image.width) * image.height * 4);
+    row.resize(size_t(image.width) * 3);
+    while (jpeg.output_scanline < jpeg.output_height) {
+        auto* dst = image.pixels.data() + size_t(jpeg.output_scanline) * image.width * 4;
+        auto* rowPointer = row.data();
+        jpeg_read_scanlines(&jpeg, &rowPointer, 1);
+        for (uint32_t x = 0; x < image.width; x++) {
+            dst[x * 4 + 0] = row[x * 3 + 0];
+            dst[x * 4 + 1] = row[x * 3 + 1];
+            dst[x * 4 + 2] = row[x * 3 + 2];
+            dst[x * 4 + 3] = 255;
+        }
+    }
+    jpeg_finish_decompress(&jpeg);
+    jpeg_destroy_decompress(&jpeg);
+    return image;
+}
+#endif
+
+std::optional<DecodedImage> decodeHost(const std::vector<uint8_t>& data) {
+    if (auto png = decodePng(data.data(), data.size())) return png;
+    if (auto png = decodeLibpng(data)) return png;
+#ifdef CDI_HAVE_JPEG
+    if (auto jpeg = decodeLibjpeg(data)) return jpeg;
+#endif
+    return std::nullopt;
+}
+
+std::vector<uint8_t> encodeSyntheticPng(uint32_t width, uint32_t height, bool alpha) {
+    int channels = alpha ? 4 : 3;
+    std::vector<uint8_t> pixels(size_t(width) * height * channels);
+    std::mt19937 rng(width * 31 + height);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            auto* p = pixels.data() + (size_t(y) * width + x) * channels;
+            bool flat = ((x / 64) + (y / 64)) % 5 == 0;
+            int noise = flat ? 0 : static_cast<int>(rng() % 9) - 4;
+            p[0] = static_cast<uint8_t>(std::clamp(int(x * 255 / width) + noise, 0, 255));
+            p[1] = static_cast<uint8_t>(std::clamp(int(y * 255 / height) + noise, 0, 255));
+            p[2] = static_cast<uint8_t>(std::clamp(int((x + y) * 127 / (width + height)) + 64 + noise, 0, 255));
+            if (alpha) p[3] = static_cast<uint8_t>(flat ? 255 : (x * 7 + y * 3) & 255);
+        }
+    }
+
+    std::vector<uint8_t> out;
+    auto png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    auto info = png_create_info_struct(png);
+    png_set_write_fn(png, &out, [](png_structp png, png_bytep data, png_size_t length) {
+        auto* out = static_cast<std::vector<uint8_t>*>(png_get_io_ptr(png));
+        out->insert(out->end(), data, data + length);
+    }, nullptr);
+    png_set_IHDR(
+        png, info, width, height, 8, alpha ? PNG_COLOR_TYPE_RGBA : PNG_COLOR_TYPE_RGB,
+        PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT
+    );
+    png_write_info(png, info);
+    for (uint32_t y = 0; y < height; y++) {
+        png_write_row(png, pixels.data() + size_t(y) * width * channels);
+    }
+    png_write_end(png, nullptr);
+    png_destroy_write_struct(&png, &info);
+    return out;
+}
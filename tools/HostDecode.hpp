@@ -0,0 +1,28 @@
+#pragma once
+
+#include "DecodedImage.hpp"
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Host-side stand-ins for CCImage, producing the same premultiplied RGBA
+// pixels the mod uploads.
+
+// Decodes with libpng the way CCImage does: expand to 8-bit RGB(A), then
+// premultiply alpha in a separate pass and widen RGB to RGBA.
+std::optional<DecodedImage> decodeLibpng(const std::vector<uint8_t>& data);
+
+#ifdef CDI_HAVE_JPEG
+// CCImage also accepts JPEGs whatever their extension says; the bundled
+// death.png is one.
+std::optional<DecodedImage> decodeLibjpeg(const std::vector<uint8_t>& data);
+#endif
+
+// decodePng, then whichever of the above accepts the data, like decodeImage
+// in the mod
+std::optional<DecodedImage> decodeHost(const std::vector<uint8_t>& data);
+
+// Encodes a photo-like test image with libpng: smooth gradients, noise and a
+// few flat areas, so the encoder picks a mix of filters. Deterministic for a
+// given size.
+std::vector<uint8_t> encodeSyntheticPng(uint32_t width, uint32_t height, bool alpha);
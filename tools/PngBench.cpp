@@ -0,0 +1,93 @@
+// Times PngDecoder against libpng decoding the way CCImage does it: libpng
+// expands to 8-bit RGB(A), then a separate pass premultiplies alpha and RGB
+// is widened to RGBA for upload. Also checks both produce the same pixels.
+//
+//   cdi-bench-png [extra.png ...]
+
+#include "HostDecode.hpp"
+#include "PngDecoder.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+    std::vector<uint8_t> readFile(const std::filesystem::path& path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), {});
+    }
+
+    // Median of enough runs to fill roughly half a second
+    double timeMs(const std::function<void()>& run) {
+        std::vector<double> samples;
+        double total = 0;
+        while (samples.size() < 3 || (total < 500 && samples.size() < 50)) {
+            auto start = std::chrono::steady_clock::now();
+            run();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            samples.push_back(ms);
+            total += ms;
+        }
+        std::sort(samples.begin(), samples.end());
+        return samples[samples.size() / 2];
+    }
+
+    void bench(const std::string& name, const std::vector<uint8_t>& data) {
+        auto reference = decodeLibpng(data);
+        auto ours = decodePng(data.data(), data.size());
+        if (!reference) {
+            std::printf("%-28s not a PNG libpng can read, skipped\n", name.c_str());
+            return;
+        }
+        if (!ours) {
+            std::printf("%-28s %5ux%-5u unsupported, falls back to CCImage\n", name.c_str(), reference->width, reference->height);
+            return;
+        }
+
+        bool match = ours->width == reference->width && ours->height == reference->height
+            && ours->pixels == reference->pixels;
+
+        double libpngMs = timeMs([&] { decodeLibpng(data); });
+        double oursMs = timeMs([&] { decodePng(data.data(), data.size()); });
+        std::printf(
+            "%-28s %5ux%-5u %10.2f %10.2f %8.2fx  %s\n",
+            name.c_str(), ours->width, ours->height, libpngMs, oursMs, libpngMs / oursMs,
+            match ? "identical" : "MISMATCH"
+        );
+    }
+}
+
+int main(int argc, char** argv) {
+    std::printf("%-28s %11s %10s %10s %9s  %s\n", "image", "size", "libpng ms", "cdi ms", "speedup", "pixels");
+
+    std::filesystem::path resources = CDI_RESOURCES_DIR;
+    for (auto name : { "death.png", "livereact.png" }) {
+        bench(name, readFile(resources / name));
+    }
+
+    struct Synthetic {
+        uint32_t width;
+        uint32_t height;
+        bool alpha;
+    };
+    for (auto [width, height, alpha] : {
+        Synthetic { 256, 256, true },
+        Synthetic { 1024, 1024, true },
+        Synthetic { 1920, 1080, false },
+        Synthetic { 3840, 2160, false },
+        Synthetic { 3840, 2160, true },
+        Synthetic { 7680, 4320, true },
+    }) {
+        auto name = "synthetic " + std::string(alpha ? "RGBA" : "RGB");
+        bench(name, encodeSyntheticPng(width, height, alpha));
+    }
+
+    for (int i = 1; i < argc; i++) {
+        bench(std::filesystem::path(argv[i]).filename().string(), readFile(argv[i]));
+    }
+    return 0;
+}